@@ -0,0 +1,74 @@
+#!/bin/bash
+#############################################################
+# MAKE_BENCH.sh                                             #
+# ......................................................... #
+# This script builds each Timonel configuration and runs it #
+# under simavr with "tml-bench", printing its command,      #
+# clock stretching and flash time tables (markdown).        #
+# ......................................................... #
+# 2020-06-06 Gustavo Casanova                               #
+# ......................................................... #
+# Requires avr-gcc (as set in the bootloader Makefile) and  #
+# simavr. Build "src/tml-bench" first with "make".          #
+#                                                           #
+#############################################################
+
+# Command line arguments
+# ----------------------
+# ARGS: Timonel configurations to bench. Default: all the configurations in "configs".
+# SCL: Environment variable, I2C clock in Hz. Default [ SCL=${SCL:-100000} ]
+
+TML_DIR="../timonel-bootloader";
+CFG_DIR="configs";
+TML_CFG="tml-config.mak";
+PLD_DIR="../timonel-hexparser/appl-payload";
+BENCH="src/tml-bench";
+SCL=${SCL:-100000};
+
+# Get a setting value from a configuration file
+function cfg_value {
+    grep -E "^$2[[:space:]]*=" "$1" | head -n 1 | sed -E 's/^[^=]*=[[:space:]]*//; s/[[:space:]]*$//';
+}
+
+if [ ! -x ${BENCH} ]; then
+    echo "${BENCH} not found, build it with \"make -C src\"";
+    exit 1;
+fi
+
+CONFIGS="$@";
+if [ -z "${CONFIGS}" ]; then
+    CONFIGS=`ls ${TML_DIR}/${CFG_DIR}`;
+fi
+
+for CONFIG in ${CONFIGS}; do
+    CFG_FILE="${TML_DIR}/${CFG_DIR}/${CONFIG}/${TML_CFG}";
+    if [ ! -f ${CFG_FILE} ]; then
+        echo "Configuration not found: ${CONFIG}" >&2;
+        continue;
+    fi
+    # tml-bench simulates an ATtiny85, other MCUs have the USI registers and page size elsewhere
+    if [ "`cfg_value ${CFG_FILE} MCU`" != "attiny85" ]; then
+        echo "Skipping ${CONFIG}: tml-bench only simulates the ATtiny85" >&2;
+        continue;
+    fi
+    BENCH_OPT="--config ${CONFIG} --scl ${SCL}";
+    BENCH_OPT+=" --address `cfg_value ${CFG_FILE} TIMONEL_TWI_ADDR`";
+    BENCH_OPT+=" --packet-size `cfg_value ${CFG_FILE} MST_PACKET_SIZE`";
+    BENCH_OPT+=" --read-size `cfg_value ${CFG_FILE} SLV_PACKET_SIZE`";
+    # Timonel clears the clock prescaler: 16 MHz with the PLL clock source, 8 MHz with the RC oscillator
+    if [ $(( `cfg_value ${CFG_FILE} LOW_FUSE` & 0x0F )) -eq 1 ]; then
+        BENCH_OPT+=" --clock 16000000";
+    else
+        BENCH_OPT+=" --clock 8000000";
+    fi
+    if [ "`cfg_value ${CFG_FILE} WRITPAGE_BUSY`" == "true" ]; then
+        BENCH_OPT+=" --busy-byte";
+    fi
+    make -C ${TML_DIR} clean_all CONFIG=${CONFIG} > /dev/null;
+    if make -C ${TML_DIR} all CONFIG=${CONFIG} TARGET=timonel > /dev/null; then
+        ${BENCH} ${BENCH_OPT} ${TML_DIR}/timonel.bin ${PLD_DIR}/*.h;
+    else
+        echo "Build failed: ${CONFIG}" >&2;
+    fi
+    make -C ${TML_DIR} clean_all CONFIG=${CONFIG} > /dev/null;
+done
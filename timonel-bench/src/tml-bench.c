@@ -0,0 +1,737 @@
+/*
+ ********************************************************
+ * Timonel Bench                                        *
+ * Version: 0.1 | For Linux (simavr)                    *
+ * .................................................... *
+ * 2020-06-06 gustavo.casanova@nicebots.com             *
+ * .................................................... *
+ * Cycle-accurate benchmark of the Timonel USI TWI      *
+ * state machine. It runs a bootloader ELF under        *
+ * simavr, models the ATtiny85 USI in two-wire mode and *
+ * drives it from a scripted I2C master, measuring the  *
+ * cycles spent on each command, the clock stretching  *
+ * and the time to flash each payload.                  *
+ ********************************************************
+ */
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tml-twim.h"
+
+#define TML_BENCH_VERSION " Timonel Bench version: 0.1"
+
+// Timonel commands not available in "tml-twim.h" (same values as "nb-twi-cmd.h")
+#ifndef READDEVS
+#define READDEVS 0x88 /* Read the device fuses, lock bits and signature */
+#define ACKRDEVS 0x77 /* READDEVS command acknowledge */
+#endif                /* READDEVS */
+#ifndef WRITEEPR
+#define WRITEEPR 0x89 /* Write a byte into the EEPROM */
+#define ACKWTEEP 0x76 /* WRITEEPR command acknowledge */
+#endif                /* WRITEEPR */
+#ifndef READEEPR
+#define READEEPR 0x8A /* Read a byte from the EEPROM */
+#define ACKRDEEP 0x75 /* READEEPR command acknowledge */
+#endif                /* READEEPR */
+
+// ATtiny85 data space addresses (I/O address + 0x20)
+#define REG_PINB 0x36
+#define REG_DDRB 0x37
+#define REG_PORTB 0x38
+#define REG_USICR 0x2D
+#define REG_USISR 0x2E
+#define REG_USIDR 0x2F
+#define PIN_SDA 0 /* PB0 */
+#define PIN_SCL 2 /* PB2 */
+
+// USI register bits
+#define USI_SIF 7 /* USISR start condition flag */
+#define USI_OIF 6 /* USISR counter overflow flag */
+#define USI_PF 5  /* USISR stop condition flag */
+#define USI_WM0 4 /* USICR wire mode bit 0: hold SCL low on counter overflow */
+#define USI_WM1 5 /* USICR wire mode bit 1: two-wire mode */
+
+#define RELEASE_TIMEOUT_MS 100 /* Longest SCL hold accepted before giving up */
+#define MAX_PAYLOADS 32
+
+// Firmware handler that runs while the USI holds SCL low (named after the overflow states)
+typedef enum phase {
+    PH_NONE = -1,
+    PH_START = 0,      // TwiStartHandler
+    PH_ADDRESS_W,      // STATE_CHECK_RECEIVED_ADDRESS, write
+    PH_ADDRESS_R,      // STATE_CHECK_RECEIVED_ADDRESS, read (runs ProcessCommand)
+    PH_RECEIVE_DATA,   // STATE_RECEIVE_DATA_BYTE
+    PH_PUT_BYTE,       // STATE_PUT_BYTE_IN_RX_BUFFER_AND_SEND_ACK
+    PH_SEND_DATA,      // STATE_SEND_DATA_BYTE
+    PH_RECEIVE_ACK,    // STATE_RECEIVE_ACK_AFTER_SENDING_DATA
+    PH_CHECK_ACK,      // STATE_CHECK_RECEIVED_ACK
+    PH_COUNT
+} Phase;
+
+static const char *phase_names[PH_COUNT] = {
+    "TwiStartHandler",
+    "CHECK_RECEIVED_ADDRESS (write)",
+    "CHECK_RECEIVED_ADDRESS (read) + ProcessCommand",
+    "RECEIVE_DATA_BYTE",
+    "PUT_BYTE_IN_RX_BUFFER_AND_SEND_ACK",
+    "SEND_DATA_BYTE",
+    "RECEIVE_ACK_AFTER_SENDING_DATA",
+    "CHECK_RECEIVED_ACK",
+};
+
+// Benchmarked Timonel commands
+typedef enum command_ix {
+    CX_GETTMNLV = 0,
+    CX_INITSOFT,
+    CX_STPGADDR,
+    CX_WRITPAGE,
+    CX_READFLSH,
+    CX_READDEVS,
+    CX_WRITEEPR,
+    CX_READEEPR,
+    CX_COUNT
+} CommandIx;
+
+static const char *command_names[CX_COUNT] = {
+    "GETTMNLV", "INITSOFT", "STPGADDR", "WRITPAGE", "READFLSH", "READDEVS", "WRITEEPR", "READEEPR",
+};
+
+// Clock stretching statistics of one handler
+typedef struct phase_stats {
+    uint32_t count;
+    uint64_t total;
+    uint32_t min;
+    uint32_t max;
+} PhaseStats;
+
+// Bus time and clock stretching of one command (write + repeated start + read)
+typedef struct command_stats {
+    uint32_t runs;
+    uint16_t wr_len;
+    uint16_t rd_len;
+    uint64_t bus_cycles;
+    uint64_t stretch_cycles;
+    uint32_t max_stretch;
+    Phase max_phase;
+} CommandStats;
+
+// Time to flash one payload
+typedef struct flash_stats {
+    const char *file;
+    uint16_t size;
+    uint16_t pages;
+    uint64_t cycles;
+    uint64_t wait_cycles;
+    int result;
+} FlashStats;
+
+// Bench settings, taken from the bootloader build settings
+typedef struct settings {
+    const char *elf_file;
+    const char *config;
+    uint8_t addr;
+    uint32_t cpu_hz;
+    uint32_t scl_hz;
+    uint8_t packet_size;
+    uint8_t read_size;
+    bool busy_byte;
+    uint16_t page_delay_ms;
+} Settings;
+
+// Simulated USI and bus lines
+typedef struct usi_model {
+    uint8_t cr;
+    uint8_t flags;
+    uint8_t cnt;
+    uint8_t dr;
+    bool sda;
+    bool scl;
+} UsiModel;
+
+// Function prototypes
+static int OpenSession(void);
+static void CloseSession(void);
+static void HookIo(avr_io_addr_t addr, avr_io_read_t read, avr_io_write_t write);
+static uint8_t ReadUsi(avr_t *avr, avr_io_addr_t addr, void *param);
+static void WriteUsi(avr_t *avr, avr_io_addr_t addr, uint8_t value, void *param);
+static uint8_t ReadPinb(avr_t *avr, avr_io_addr_t addr, void *param);
+static int Step(void);
+static int RunFor(uint64_t cycles);
+static bool SclHeld(void);
+static int WaitRelease(void);
+static int Shift(uint8_t bits, uint8_t master_out, uint8_t *line);
+static int BusStart(void);
+static int BusStop(void);
+static int BusWrite(uint8_t data, Phase after_data, Phase after_ack);
+static int BusRead(uint8_t *data, bool ack);
+static int Command(CommandIx cx, const uint8_t *command, uint8_t command_len, uint8_t *reply, uint8_t reply_len);
+static int BenchCommands(void);
+static int FlashPayload(FlashStats *flash);
+static int LoadPayload(const char *path, uint8_t *image, uint16_t *size);
+static double CyclesToUs(uint64_t cycles);
+static void PrintTables(const FlashStats *flashes, uint8_t flash_count);
+
+static Settings settings = {NULL, NULL, 11, 8000000, 100000, 32, 32, false, 10};
+static avr_t *avr = NULL;
+static elf_firmware_t firmware;
+static UsiModel usi;
+static Phase pending_phase = PH_NONE;     // Handler that runs when SCL is released next
+static CommandStats *current = NULL;      // Command the stretching is accounted to
+static PhaseStats phases[PH_COUNT];
+static CommandStats commands[CX_COUNT];
+static uint32_t max_stretch = 0;
+static Phase max_stretch_phase = PH_NONE;
+static uint32_t bit_cycles = 80;
+static TmlInfo info;
+
+// Main function
+int main(int argc, char *argv[]) {
+    static FlashStats flashes[MAX_PAYLOADS];
+    uint8_t flash_count = 0;
+    char *usage = "\n Timonel Bench\n =============\n usage: tml-bench [--help] [options] timonel.bin [payload.h ...]\n";
+
+    // Command argument handling
+    for (int arg_pointer = 1; arg_pointer < argc; arg_pointer++) {
+        const char *arg = argv[arg_pointer];
+        const char *value = ((arg_pointer + 1) < argc) ? argv[arg_pointer + 1] : NULL;
+        if ((strcmp(arg, "--help") == 0) || (strcmp(arg, "-h") == 0)) {
+            puts(usage);
+            puts("   --config NAME: Configuration name shown on the tables");
+            puts("     --address N: Timonel TWI address (TIMONEL_TWI_ADDR, default 11)");
+            puts("       --clock N: CPU clock in Hz (8000000 for RC oscillator builds, 16000000 for PLL)");
+            puts("         --scl N: I2C clock in Hz (default 100000)");
+            puts(" --packet-size N: WRITPAGE data bytes per packet (MST_PACKET_SIZE, default 32)");
+            puts("   --read-size N: READFLSH data bytes per reply (SLV_PACKET_SIZE, default 32)");
+            puts("     --busy-byte: WRITPAGE replies carry the busy time (WRITPAGE_BUSY)");
+            puts("  --page-delay N: Page write wait in ms without --busy-byte (default 10)");
+            puts("     timonel.bin: Bootloader ELF, as linked by the bootloader Makefile");
+            puts("       payload.h: Application payloads made by the hexparser, flashed one by one");
+            puts("");
+            puts(TML_BENCH_VERSION);
+            return EXIT_SUCCESS;
+        } else if (strcmp(arg, "--busy-byte") == 0) {
+            settings.busy_byte = true;
+        } else if ((strcmp(arg, "--config") == 0) && (value != NULL)) {
+            settings.config = value;
+            arg_pointer++;
+        } else if ((strcmp(arg, "--address") == 0) && (value != NULL)) {
+            settings.addr = (uint8_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--clock") == 0) && (value != NULL)) {
+            settings.cpu_hz = (uint32_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--scl") == 0) && (value != NULL)) {
+            settings.scl_hz = (uint32_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--packet-size") == 0) && (value != NULL)) {
+            settings.packet_size = (uint8_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--read-size") == 0) && (value != NULL)) {
+            settings.read_size = (uint8_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--page-delay") == 0) && (value != NULL)) {
+            settings.page_delay_ms = (uint16_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if (arg[0] == '-') {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return EXIT_FAILURE;
+        } else if (settings.elf_file == NULL) {
+            settings.elf_file = arg;
+        } else if (flash_count < MAX_PAYLOADS) {
+            flashes[flash_count++].file = arg;
+        }
+    }
+    if (settings.elf_file == NULL) {
+        puts(usage);
+        return EXIT_FAILURE;
+    }
+    if ((settings.packet_size == 0) || (settings.packet_size > TML_MAX_PACKET_SIZE) ||
+        (settings.read_size == 0) || (settings.read_size > TML_MAX_PACKET_SIZE) ||
+        (settings.scl_hz == 0) || (settings.scl_hz > (settings.cpu_hz / 4))) {
+        fprintf(stderr, "Invalid packet size, read size or clock settings\n");
+        return EXIT_FAILURE;
+    }
+    if (settings.config == NULL) {
+        settings.config = settings.elf_file;
+    }
+    bit_cycles = (settings.cpu_hz / settings.scl_hz);
+    if (elf_read_firmware(settings.elf_file, &firmware) != 0) {
+        fprintf(stderr, "Unable to read the bootloader ELF: %s\n", settings.elf_file);
+        return EXIT_FAILURE;
+    }
+
+    // Per-command cycles, on a freshly started bootloader
+    int result = BenchCommands();
+    if (result != TML_OK) {
+        fprintf(stderr, "[%s] Command bench failed: %s\n", settings.config, TmlStrError(result));
+        return EXIT_FAILURE;
+    }
+    // End-to-end flash time, each payload on a freshly started bootloader with blank flash
+    for (uint8_t i = 0; i < flash_count; i++) {
+        flashes[i].result = FlashPayload(&flashes[i]);
+    }
+    PrintTables(flashes, flash_count);
+    return EXIT_SUCCESS;
+}
+
+/* _____________________
+  |                     |
+  |   Simulator setup   |
+  |_____________________|
+*/
+// Create a new simulated device running the bootloader, and wait for it to set up the USI.
+static int OpenSession(void) {
+    avr = avr_make_mcu_by_name("attiny85");
+    if (avr == NULL) {
+        fprintf(stderr, "simavr doesn't support the ATtiny85\n");
+        exit(EXIT_FAILURE);
+    }
+    avr_init(avr);
+    memset(avr->flash, 0xFF, (avr->flashend + 1));  // Blank application flash
+    avr_load_firmware(avr, &firmware);
+    avr->frequency = settings.cpu_hz;
+    avr->pc = firmware.flashbase;  // A blank device runs into the bootloader, start there right away
+    memset(&usi, 0, sizeof(usi));
+    usi.sda = usi.scl = true;
+    pending_phase = PH_NONE;
+    current = NULL;
+    HookIo(REG_USICR, ReadUsi, WriteUsi);
+    HookIo(REG_USISR, ReadUsi, WriteUsi);
+    HookIo(REG_USIDR, ReadUsi, WriteUsi);
+    HookIo(REG_PINB, ReadPinb, NULL);
+    // Run until the bootloader sets the USI in two-wire mode
+    uint64_t limit = avr->cycle + ((uint64_t)settings.cpu_hz * RELEASE_TIMEOUT_MS / 1000);
+    while (!((usi.cr >> USI_WM1) & true)) {
+        if ((Step() != TML_OK) || (avr->cycle > limit)) {
+            return TML_ERR_TIMEOUT;
+        }
+    }
+    return RunFor(bit_cycles * 10);
+}
+static void CloseSession(void) {
+    avr_terminate(avr);
+    avr = NULL;
+}
+// Set the register callbacks directly: the port B ones are already taken by simavr, which
+// refuses to override them, and its pin register shows the port latch for output pins.
+static void HookIo(avr_io_addr_t addr, avr_io_read_t read, avr_io_write_t write) {
+    avr->io[AVR_DATA_TO_IO(addr)].r.c = read;
+    avr->io[AVR_DATA_TO_IO(addr)].r.param = NULL;
+    if (write != NULL) {
+        avr->io[AVR_DATA_TO_IO(addr)].w.c = write;
+        avr->io[AVR_DATA_TO_IO(addr)].w.param = NULL;
+    }
+}
+
+/* _____________________
+  |                     |
+  |      USI model      |
+  |_____________________|
+*/
+// The USI isn't modeled by simavr: the bench keeps its registers and shifts the
+// bits itself, at the I2C clock rate, whenever the firmware releases SCL.
+static uint8_t ReadUsi(avr_t *avr, avr_io_addr_t addr, void *param) {
+    (void)avr;
+    (void)param;
+    switch (addr) {
+        case REG_USICR:
+            return usi.cr;
+        case REG_USISR:
+            return (usi.flags | usi.cnt);
+        default:
+            return usi.dr;
+    }
+}
+static void WriteUsi(avr_t *avr, avr_io_addr_t addr, uint8_t value, void *param) {
+    (void)avr;
+    (void)param;
+    switch (addr) {
+        case REG_USICR:
+            usi.cr = value;
+            break;
+        case REG_USISR:
+            usi.flags &= ~(value & 0xE0);  // Flags are cleared by writing ones
+            usi.cnt = (value & 0x0F);
+            break;
+        default:
+            usi.dr = value;
+            break;
+    }
+}
+// Port B pins, with SDA and SCL showing the bus lines instead of the port latch.
+static uint8_t ReadPinb(avr_t *avr, avr_io_addr_t addr, void *param) {
+    (void)addr;
+    (void)param;
+    uint8_t ddr = avr->data[REG_DDRB];
+    uint8_t pins = ((avr->data[REG_PORTB] & ddr) | (~ddr & 0xFF));
+    pins &= ~((1 << PIN_SDA) | (1 << PIN_SCL));
+    return (pins | (usi.sda << PIN_SDA) | (usi.scl << PIN_SCL));
+}
+static int Step(void) {
+    int state = avr_run(avr);
+    return (((state == cpu_Done) || (state == cpu_Crashed)) ? TML_ERR_IO : TML_OK);
+}
+static int RunFor(uint64_t cycles) {
+    uint64_t target = (avr->cycle + cycles);
+    while (avr->cycle < target) {
+        if (Step() != TML_OK) {
+            return TML_ERR_IO;
+        }
+    }
+    return TML_OK;
+}
+// The start detector holds SCL low until its flag is cleared, the counter overflow
+// does the same in the two-wire mode that holds SCL (USIWM0 set).
+static bool SclHeld(void) {
+    return (((usi.flags >> USI_SIF) & true) ||
+            (((usi.flags >> USI_OIF) & true) && ((usi.cr >> USI_WM0) & true)));
+}
+// Run the firmware until it releases SCL, accounting the stretch to the pending handler.
+static int WaitRelease(void) {
+    uint64_t start = avr->cycle;
+    uint64_t limit = (start + ((uint64_t)settings.cpu_hz * RELEASE_TIMEOUT_MS / 1000));
+    while (SclHeld()) {
+        if ((Step() != TML_OK) || (avr->cycle > limit)) {
+            return TML_ERR_TIMEOUT;
+        }
+    }
+    if (pending_phase != PH_NONE) {
+        uint32_t stretch = (uint32_t)(avr->cycle - start);
+        PhaseStats *ps = &phases[pending_phase];
+        ps->min = ((ps->count == 0) || (stretch < ps->min)) ? stretch : ps->min;
+        ps->max = (stretch > ps->max) ? stretch : ps->max;
+        ps->total += stretch;
+        ps->count++;
+        if (stretch > max_stretch) {
+            max_stretch = stretch;
+            max_stretch_phase = pending_phase;
+        }
+        if (current != NULL) {
+            current->stretch_cycles += stretch;
+            if (stretch > current->max_stretch) {
+                current->max_stretch = stretch;
+                current->max_phase = pending_phase;
+            }
+        }
+        pending_phase = PH_NONE;
+    }
+    return TML_OK;
+}
+// Clock 8 bits or 1 bit as set by the firmware in the 4-bit counter. SDA is the
+// wired AND of what the master sends and what the USI drives from USIDR bit 7.
+static int Shift(uint8_t bits, uint8_t master_out, uint8_t *line) {
+    int result = WaitRelease();
+    if (result != TML_OK) {
+        return result;
+    }
+    if (((16 - usi.cnt) / 2) != bits) {
+        return TML_ERR_ACK;  // The firmware set up an unexpected transfer length
+    }
+    bool slave_drives = ((avr->data[REG_DDRB] >> PIN_SDA) & true);
+    if (bits == 8) {
+        *line = (master_out & (slave_drives ? usi.dr : 0xFF));
+    } else {
+        *line = (master_out & (slave_drives ? (usi.dr >> 7) : 1) & 1);
+    }
+    usi.scl = false;
+    if (RunFor((uint64_t)bits * bit_cycles) != TML_OK) {
+        return TML_ERR_IO;
+    }
+    usi.dr = ((bits == 8) ? *line : (uint8_t)((usi.dr << 1) | *line));
+    usi.cnt = 0;
+    usi.flags |= (1 << USI_OIF);
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |     I2C master      |
+  |_____________________|
+*/
+// Start or repeated start: SDA falls while SCL is high, then SCL falls.
+static int BusStart(void) {
+    int result = WaitRelease();
+    if (result != TML_OK) {
+        return result;
+    }
+    if (RunFor(bit_cycles) != TML_OK) {
+        return TML_ERR_IO;
+    }
+    usi.sda = usi.scl = false;
+    usi.cnt = 0;
+    usi.flags |= (1 << USI_SIF);
+    pending_phase = PH_START;
+    return TML_OK;
+}
+// Stop: SDA rises while SCL is high.
+static int BusStop(void) {
+    int result = WaitRelease();
+    if (result != TML_OK) {
+        return result;
+    }
+    if (RunFor(bit_cycles) != TML_OK) {
+        return TML_ERR_IO;
+    }
+    usi.sda = usi.scl = true;
+    usi.flags |= (1 << USI_PF);
+    return TML_OK;
+}
+// Send a byte and check the slave acknowledge.
+static int BusWrite(uint8_t data, Phase after_data, Phase after_ack) {
+    uint8_t line;
+    int result = Shift(8, data, &line);
+    if (result != TML_OK) {
+        return result;
+    }
+    pending_phase = after_data;
+    result = Shift(1, 1, &line);
+    if (result != TML_OK) {
+        return result;
+    }
+    pending_phase = after_ack;
+    return ((line == 0) ? TML_OK : TML_ERR_ACK);
+}
+// Receive a byte and acknowledge it, or not if it's the last one.
+static int BusRead(uint8_t *data, bool ack) {
+    uint8_t line;
+    int result = Shift(8, 0xFF, data);
+    if (result != TML_OK) {
+        return result;
+    }
+    pending_phase = PH_RECEIVE_ACK;
+    result = Shift(1, (ack ? 0 : 1), &line);
+    if (result != TML_OK) {
+        return result;
+    }
+    pending_phase = PH_CHECK_ACK;
+    return TML_OK;
+}
+// Send a command and read its reply after a repeated start, like "tml-host" does.
+static int Command(CommandIx cx, const uint8_t *command, uint8_t command_len, uint8_t *reply, uint8_t reply_len) {
+    CommandStats *cs = &commands[cx];
+    uint64_t start = avr->cycle;
+    int result;
+    current = cs;
+    if ((result = BusStart()) != TML_OK) return result;
+    if ((result = BusWrite((settings.addr << 1), PH_ADDRESS_W, PH_RECEIVE_DATA)) != TML_OK) return result;
+    for (uint8_t i = 0; i < command_len; i++) {
+        if ((result = BusWrite(command[i], PH_PUT_BYTE, PH_RECEIVE_DATA)) != TML_OK) return result;
+    }
+    if ((result = BusStart()) != TML_OK) return result;
+    if ((result = BusWrite(((settings.addr << 1) | 1), PH_ADDRESS_R, PH_SEND_DATA)) != TML_OK) return result;
+    for (uint8_t i = 0; i < reply_len; i++) {
+        if ((result = BusRead(&reply[i], (i < (reply_len - 1)))) != TML_OK) return result;
+    }
+    if ((result = BusStop()) != TML_OK) return result;
+    current = NULL;
+    cs->bus_cycles += (avr->cycle - start);
+    cs->wr_len = command_len;
+    cs->rd_len = reply_len;
+    cs->runs++;
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |   Bench sequences   |
+  |_____________________|
+*/
+// Run every command available in this build once.
+static int BenchCommands(void) {
+    uint8_t reply[1 + TML_MAX_PACKET_SIZE + 2];
+    int result = OpenSession();
+    if (result == TML_OK) {
+        const uint8_t command[] = {GETTMNLV};
+        result = Command(CX_GETTMNLV, command, sizeof(command), reply, TML_GETTMNLV_RPLYLN);
+        if ((result == TML_OK) && (reply[0] != ACKTMNLV)) {
+            result = TML_ERR_ACK;
+        }
+        info.features = reply[4];
+        info.ext_features = reply[5];
+        info.start_addr = ((reply[6] << 8) | reply[7]);
+    }
+    if (result == TML_OK) {
+        const uint8_t command[] = {INITSOFT};
+        result = Command(CX_INITSOFT, command, sizeof(command), reply, 1);
+    }
+    bool use_crc16 = ((info.ext_features >> TML_EF_USE_CRC16) & true);
+    if ((result == TML_OK) && ((info.features >> TML_FT_CMD_READFLASH) & true)) {
+        const uint8_t command[] = {READFLSH, (uint8_t)(info.start_addr >> 8), (uint8_t)(info.start_addr & 0xFF), settings.read_size};
+        result = Command(CX_READFLSH, command, sizeof(command), reply, (1 + settings.read_size + (use_crc16 ? 2 : 1)));
+    }
+    if ((result == TML_OK) && ((info.ext_features >> TML_EF_CMD_READDEVS) & true)) {
+        const uint8_t command[] = {READDEVS};
+        result = Command(CX_READDEVS, command, sizeof(command), reply, 10);
+    }
+    if ((result == TML_OK) && ((info.ext_features >> TML_EF_EEPROM_ACCESS) & true)) {
+        const uint8_t write_command[] = {WRITEEPR, 0x00, 0x10, 0x5A};
+        const uint8_t read_command[] = {READEEPR, 0x00, 0x10};
+        result = Command(CX_WRITEEPR, write_command, sizeof(write_command), reply, 2);
+        if (result == TML_OK) {
+            result = Command(CX_READEEPR, read_command, sizeof(read_command), reply, 3);
+        }
+    }
+    CloseSession();
+    return result;
+}
+// Initialize the bootloader and write a payload, page by page, waiting for each page write.
+static int FlashPayload(FlashStats *flash) {
+    static uint8_t image[TML_FLASH_SIZE];
+    uint8_t command[1 + TML_MAX_PACKET_SIZE + 2];
+    uint8_t reply[1 + TML_MAX_PACKET_SIZE + 2];
+    int result = LoadPayload(flash->file, image, &flash->size);
+    if (result != TML_OK) {
+        return result;
+    }
+    uint16_t padded = ((flash->size + TML_SPM_PAGESIZE - 1) & ~(TML_SPM_PAGESIZE - 1));
+    memset(&image[flash->size], 0xFF, (padded - flash->size));
+    flash->pages = (padded / TML_SPM_PAGESIZE);
+    if ((result = OpenSession()) != TML_OK) {
+        return result;
+    }
+    uint64_t start = avr->cycle;
+    command[0] = GETTMNLV;
+    result = Command(CX_GETTMNLV, command, 1, reply, TML_GETTMNLV_RPLYLN);
+    if ((result == TML_OK) && (padded > ((reply[6] << 8) | reply[7]))) {
+        result = TML_ERR_SIZE;  // The payload overlaps the bootloader
+    }
+    if (result == TML_OK) {
+        command[0] = INITSOFT;
+        result = Command(CX_INITSOFT, command, 1, reply, 1);
+    }
+    bool use_crc16 = ((info.ext_features >> TML_EF_USE_CRC16) & true);
+    bool set_page_addr = (((info.features >> TML_FT_CMD_SETPGADDR) & true) && !((info.features >> TML_FT_AUTO_PAGE_ADDR) & true));
+    for (uint16_t page_addr = 0; (result == TML_OK) && (page_addr < padded); page_addr += TML_SPM_PAGESIZE) {
+        if (set_page_addr) {
+            command[0] = STPGADDR;
+            command[1] = (uint8_t)(page_addr >> 8);
+            command[2] = (uint8_t)(page_addr & 0xFF);
+            result = Command(CX_STPGADDR, command, 3, reply, 2);
+        }
+        uint8_t busy_ms = 0;
+        for (uint8_t packet = 0; (result == TML_OK) && (packet < (TML_SPM_PAGESIZE / settings.packet_size)); packet++) {
+            const uint8_t *data = &image[page_addr + (packet * settings.packet_size)];
+            uint8_t command_len = (1 + settings.packet_size);
+            command[0] = WRITPAGE;
+            memcpy(&command[1], data, settings.packet_size);
+            if (use_crc16) {
+                uint16_t crc = 0x0000;
+                for (uint8_t i = 0; i < settings.packet_size; i++) {
+                    crc = TmlCrc16(crc, data[i]);
+                }
+                command[command_len++] = (uint8_t)(crc >> 8);
+                command[command_len++] = (uint8_t)(crc & 0xFF);
+            } else {
+                uint8_t checksum = 0;
+                for (uint8_t i = 0; i < settings.packet_size; i++) {
+                    checksum += data[i];
+                }
+                command[command_len++] = checksum;
+            }
+            uint8_t reply_len = (command_len - settings.packet_size + (settings.busy_byte ? 1 : 0));
+            result = Command(CX_WRITPAGE, command, command_len, reply, reply_len);
+            if ((result == TML_OK) && (reply[0] != ACKWTPAG)) {
+                result = TML_ERR_REJECTED;
+            }
+            busy_ms = (settings.busy_byte ? reply[reply_len - 1] : 0);
+        }
+        // simavr doesn't halt the CPU while writing the page, the bootloader keeps running
+        // through the wait, as the master can't tell it apart from a real page write.
+        uint64_t wait = ((uint64_t)settings.cpu_hz * (settings.busy_byte ? busy_ms : settings.page_delay_ms) / 1000);
+        if ((result == TML_OK) && (RunFor(wait) != TML_OK)) {
+            result = TML_ERR_IO;
+        }
+        flash->wait_cycles += wait;
+    }
+    flash->cycles = (avr->cycle - start);
+    CloseSession();
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |       Helpers       |
+  |_____________________|
+*/
+// Load the byte array of a hexparser payload (".h" file with 0xNN values between braces).
+static int LoadPayload(const char *path, uint8_t *image, uint16_t *size) {
+    FILE *input = fopen(path, "r");
+    if (input == NULL) {
+        return TML_ERR_FILE;
+    }
+    int c;
+    *size = 0;
+    while (((c = fgetc(input)) != EOF) && (c != '{')) {
+    }
+    char token[8];
+    while (fscanf(input, " %7[^,} \t\r\n]", token) == 1) {
+        if (*size >= TML_FLASH_SIZE) {
+            fclose(input);
+            return TML_ERR_SIZE;
+        }
+        image[(*size)++] = (uint8_t)strtoul(token, NULL, 16);
+        c = fgetc(input);
+        while ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n')) {
+            c = fgetc(input);
+        }
+        if ((c == '}') || (c == EOF)) {
+            break;
+        }
+    }
+    fclose(input);
+    return ((*size > 0) ? TML_OK : TML_ERR_FILE);
+}
+static double CyclesToUs(uint64_t cycles) {
+    return ((double)cycles * 1000000.0 / settings.cpu_hz);
+}
+// Markdown tables: commands, handlers and payloads
+static void PrintTables(const FlashStats *flashes, uint8_t flash_count) {
+    printf("### %s\n\n", settings.config);
+    printf("CPU %u Hz, SCL %u Hz (%u cycles per bit), MST_PACKET_SIZE %u, SLV_PACKET_SIZE %u\n\n",
+           settings.cpu_hz, settings.scl_hz, bit_cycles, settings.packet_size, settings.read_size);
+    printf("| Command | Bytes (write/read) | Bus time (us) | Stretch (cycles) | Longest stretch (cycles) | Longest stretch handler |\n");
+    printf("|---|---|---|---|---|---|\n");
+    for (uint8_t i = 0; i < CX_COUNT; i++) {
+        const CommandStats *cs = &commands[i];
+        if (cs->runs == 0) {
+            continue;
+        }
+        printf("| %s | %u/%u | %.1f | %llu | %u | %s |\n", command_names[i], cs->wr_len, cs->rd_len,
+               CyclesToUs(cs->bus_cycles / cs->runs), (unsigned long long)(cs->stretch_cycles / cs->runs),
+               cs->max_stretch, ((cs->max_phase > PH_NONE) ? phase_names[cs->max_phase] : "-"));
+    }
+    printf("\n| Handler | Runs | Min (cycles) | Avg (cycles) | Max (cycles) |\n");
+    printf("|---|---|---|---|---|\n");
+    for (uint8_t i = 0; i < PH_COUNT; i++) {
+        const PhaseStats *ps = &phases[i];
+        if (ps->count == 0) {
+            continue;
+        }
+        printf("| %s | %u | %u | %llu | %u |\n", phase_names[i], ps->count, ps->min,
+               (unsigned long long)(ps->total / ps->count), ps->max);
+    }
+    printf("\nWorst-case clock stretch: %u cycles (%.1f us), %s\n", max_stretch, CyclesToUs(max_stretch),
+           ((max_stretch_phase > PH_NONE) ? phase_names[max_stretch_phase] : "-"));
+    if (flash_count > 0) {
+        printf("\n| Payload | Bytes | Pages | Flash time (ms) | Page waits (ms) | Rate (bytes/s) |\n");
+        printf("|---|---|---|---|---|---|\n");
+        for (uint8_t i = 0; i < flash_count; i++) {
+            const FlashStats *fs = &flashes[i];
+            const char *name = strrchr(fs->file, '/');
+            name = ((name != NULL) ? (name + 1) : fs->file);
+            if (fs->result != TML_OK) {
+                printf("| %s | %u | %u | %s | - | - |\n", name, fs->size, fs->pages, TmlStrError(fs->result));
+                continue;
+            }
+            double ms = (CyclesToUs(fs->cycles) / 1000.0);
+            printf("| %s | %u | %u | %.1f | %.1f | %.0f |\n", name, fs->size, fs->pages, ms,
+                   (CyclesToUs(fs->wait_cycles) / 1000.0), (fs->size * 1000.0 / ms));
+        }
+    }
+    printf("\n");
+}
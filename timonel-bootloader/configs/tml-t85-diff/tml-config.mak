@@ -6,7 +6,7 @@
 # .......................................................
 
 # Microcontroller: ATtiny 85 - 1 MHz
-# Configuration:   Small+Autorun: Only CMD_SETPGADDR and APP_AUTORUN enabled
+# Configuration:   Differential: Standard + STPGADDR, GETPGCRC, CRC-16 and general call, only changed pages are flashed
 
 MCU = attiny85
 
@@ -17,7 +17,7 @@ MCU = attiny85
 # - round that down to 94 - our new bootloader address is 94 * 64 = 6016, in hex = 1780
 # NOTE: If it doesn't compile, comment the below [# TIMONEL_START = XXXX ] line to
 
-TIMONEL_START = 1B40
+TIMONEL_START = 1B00
 
 # Timonel TWI address (decimal value):
 # -------------------------------------
@@ -30,19 +30,44 @@ TIMONEL_TWI_ADDR = 11
 # These options are commented in the "tmc-config.h" file
 
 ENABLE_LED_UI  = false
-AUTO_PAGE_ADDR = false
+AUTO_PAGE_ADDR = true
 APP_USE_TPL_PG = false
 CMD_SETPGADDR  = true
 TWO_STEP_INIT  = false
-USE_WDT_RESET  = false
+USE_WDT_RESET  = true
 APP_AUTORUN    = true
 CMD_READFLASH  = false
 CMD_READDEVS   = false
 EEPROM_ACCESS  = false
+CMD_GETPGCRC   = true
+USE_CRC16      = true
+CMD_GETWSTAT   = true
+STREAM_PAGE_FILL = false
+WRITPAGE_BUSY  = false
+TWI_BROADCAST  = true
+CMD_WRITPAGZ   = false
+CMD_READSTRM   = false
+CMD_GETIMCRC   = false
+CMD_DELPAGES   = true
+FAST_RESUME    = false
+TWI_FAST_POLL  = false
+EEPROM_BLOCKS  = false
+FAST_APP_START = false
+APP_WARM_ENTRY = false
+APP_AB_SLOTS   = false
+CMD_READSTAT   = false
+CMD_PGBURST    = false
+CMD_OSCTUNE    = false
 # Warning: Please modify the below options with caution ...
 AUTO_CLK_TWEAK = false
+FORCE_ERASE_PG = false
 LOW_FUSE       = 0x62
 LED_UI_PIN     = PB1
+EXIT_TIMEOUT_MS = 0
+STAY_PIN       = PB3
+STAY_EEP_ADDR  = E2END
+MST_PACKET_SIZE = 32
+SLV_PACKET_SIZE = 32
 
 # Project name:
 # -------------
@@ -50,8 +75,8 @@ TARGET = timonel
 
 # Timonel required libraries path:
 # --------------------------------
-#LIBDIR = ../../../nb-usitwisl-if/src
-#CMDDIR = ../../nb-twi-cmd/src
+#LIBDIR = ../../nb-libs/twis
+CMDDIR = ../../nb-libs/cmd
 
 # Settings for running at 1 Mhz starting from Timonel v1.1
 FUSEOPT = -U lfuse:w:$(LOW_FUSE):m -U hfuse:w:0xdd:m -U efuse:w:0xfe:m
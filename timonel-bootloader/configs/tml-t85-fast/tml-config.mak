@@ -6,7 +6,7 @@
 # .......................................................
 
 # Microcontroller: ATtiny 85 - 1 MHz
-# Configuration:   Standard: Page address calculation, exit timeout and WDT reset enabled
+# Configuration:   Fast: Standard + full-page (64 bytes) WRITPAGE packets streamed into the page buffer
 
 MCU = attiny85
 
@@ -17,7 +17,7 @@ MCU = attiny85
 # - round that down to 94 - our new bootloader address is 94 * 64 = 6016, in hex = 1780
 # NOTE: If it doesn't compile, comment the below [# TIMONEL_START = XXXX ] line to
 
-TIMONEL_START = 1A80
+TIMONEL_START = 1980
 
 # Timonel TWI address (decimal value):
 # -------------------------------------
@@ -39,10 +39,35 @@ APP_AUTORUN    = true
 CMD_READFLASH  = false
 CMD_READDEVS   = false
 EEPROM_ACCESS  = false
+CMD_GETPGCRC   = false
+USE_CRC16      = false
+CMD_GETWSTAT   = false
+STREAM_PAGE_FILL = true
+WRITPAGE_BUSY  = true
+TWI_BROADCAST  = false
+CMD_WRITPAGZ   = false
+CMD_READSTRM   = true
+CMD_GETIMCRC   = true
+CMD_DELPAGES   = false
+FAST_RESUME    = true
+TWI_FAST_POLL  = true
+EEPROM_BLOCKS  = false
+FAST_APP_START = false
+APP_WARM_ENTRY = false
+APP_AB_SLOTS   = false
+CMD_READSTAT   = false
+CMD_PGBURST    = false
+CMD_OSCTUNE    = false
 # Warning: Please modify the below options with caution ...
 AUTO_CLK_TWEAK = false
+FORCE_ERASE_PG = true
 LOW_FUSE       = 0x62
 LED_UI_PIN     = PB1
+EXIT_TIMEOUT_MS = 0
+STAY_PIN       = PB3
+STAY_EEP_ADDR  = E2END
+MST_PACKET_SIZE = 64
+SLV_PACKET_SIZE = 32
 
 # Project name:
 # -------------
@@ -50,8 +75,8 @@ TARGET = timonel
 
 # Timonel required libraries path:
 # --------------------------------
-#LIBDIR = ../../../nb-usitwisl-if/src
-#CMDDIR = ../../nb-twi-cmd/src
+#LIBDIR = ../../nb-libs/twis
+CMDDIR = ../../nb-libs/cmd
 
 # Settings for running at 1 Mhz starting from Timonel v1.1
 FUSEOPT = -U lfuse:w:$(LOW_FUSE):m -U hfuse:w:0xdd:m -U efuse:w:0xfe:m
@@ -39,10 +39,35 @@ APP_AUTORUN    = false
 CMD_READFLASH  = false
 CMD_READDEVS   = false
 EEPROM_ACCESS  = false
+CMD_GETPGCRC   = false
+USE_CRC16      = false
+CMD_GETWSTAT   = false
+STREAM_PAGE_FILL = false
+WRITPAGE_BUSY  = false
+TWI_BROADCAST  = false
+CMD_WRITPAGZ   = false
+CMD_READSTRM   = false
+CMD_GETIMCRC   = false
+CMD_DELPAGES   = false
+FAST_RESUME    = false
+TWI_FAST_POLL  = false
+EEPROM_BLOCKS  = false
+FAST_APP_START = false
+APP_WARM_ENTRY = false
+APP_AB_SLOTS   = false
+CMD_READSTAT   = false
+CMD_PGBURST    = false
+CMD_OSCTUNE    = false
 # Warning: Please modify the below options with caution ...
 AUTO_CLK_TWEAK = false
+FORCE_ERASE_PG = false
 LOW_FUSE       = 0x62
 LED_UI_PIN     = PB1
+EXIT_TIMEOUT_MS = 0
+STAY_PIN       = PB3
+STAY_EEP_ADDR  = E2END
+MST_PACKET_SIZE = 32
+SLV_PACKET_SIZE = 32
 
 # Project name:
 # -------------
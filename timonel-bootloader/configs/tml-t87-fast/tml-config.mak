@@ -5,19 +5,19 @@
 # 2019-06-06 gustavo.casanova@nicebots.com
 # .......................................................
 
-# Microcontroller: ATtiny 85 - 1 MHz
-# Configuration:   Standard+Dump: Page address calculation, exit timeout, WDT reset, READFLASH and EEPROM_ACCESS
+# Microcontroller: ATtiny 87 - 1 MHz
+# Configuration:   Fast: Standard + full-page (128 bytes) WRITPAGE packets streamed into the page buffer
 
-MCU = attiny85
+MCU = attiny87
 
 # Hexadecimal address for bootloader section to begin. To calculate the best value:
 # - make clean; make main.hex; ### output will list data: 2124 (or something like that)
 # - for the size of your device (8kb = 1024 * 8 = 8192) subtract above value 2124... = 6068
-# - How many pages in is that? 6068 / 64 (tiny85 page size in bytes) = 94.8125
-# - round that down to 94 - our new bootloader address is 94 * 64 = 6016, in hex = 1780
+# - How many pages in is that? 6068 / 128 (tiny87 page size in bytes) = 47.40625
+# - round that down to 47 - our new bootloader address is 47 * 128 = 6016, in hex = 1780
 # NOTE: If it doesn't compile, comment the below [# TIMONEL_START = XXXX ] line to
 
-TIMONEL_START = 19C0
+TIMONEL_START = 1980
 
 # Timonel TWI address (decimal value):
 # -------------------------------------
@@ -36,13 +36,38 @@ CMD_SETPGADDR  = false
 TWO_STEP_INIT  = false
 USE_WDT_RESET  = true
 APP_AUTORUN    = true
-CMD_READFLASH  = true
+CMD_READFLASH  = false
 CMD_READDEVS   = false
-EEPROM_ACCESS  = true
+EEPROM_ACCESS  = false
+CMD_GETPGCRC   = false
+USE_CRC16      = false
+CMD_GETWSTAT   = false
+STREAM_PAGE_FILL = true
+WRITPAGE_BUSY  = true
+TWI_BROADCAST  = false
+CMD_WRITPAGZ   = false
+CMD_READSTRM   = true
+CMD_GETIMCRC   = true
+CMD_DELPAGES   = false
+FAST_RESUME    = true
+TWI_FAST_POLL  = true
+EEPROM_BLOCKS  = false
+FAST_APP_START = false
+APP_WARM_ENTRY = false
+APP_AB_SLOTS   = false
+CMD_READSTAT   = false
+CMD_PGBURST    = false
+CMD_OSCTUNE    = false
 # Warning: Please modify the below options with caution ...
 AUTO_CLK_TWEAK = false
+FORCE_ERASE_PG = true
 LOW_FUSE       = 0x62
 LED_UI_PIN     = PB1
+EXIT_TIMEOUT_MS = 0
+STAY_PIN       = PB3
+STAY_EEP_ADDR  = E2END
+MST_PACKET_SIZE = 128
+SLV_PACKET_SIZE = 32
 
 # Project name:
 # -------------
@@ -50,15 +75,15 @@ TARGET = timonel
 
 # Timonel required libraries path:
 # --------------------------------
-#LIBDIR = ../../../nb-usitwisl-if/src
-#CMDDIR = ../../nb-twi-cmd/src
+#LIBDIR = ../../nb-libs/twis
+CMDDIR = ../../nb-libs/cmd
 
 # Settings for running at 1 Mhz starting from Timonel v1.1
 FUSEOPT = -U lfuse:w:$(LOW_FUSE):m -U hfuse:w:0xdd:m -U efuse:w:0xfe:m
 FUSEOPT_DISABLERESET = -U lfuse:w:$(LOW_FUSE):m -U hfuse:w:0x5d:m -U efuse:w:0xfe:m
 
 #---------------------------------------------------------------------
-# ATtiny85
+# ATtiny87
 #---------------------------------------------------------------------
 # Fuse extended byte:
 # 0xFE = - - - -   - 1 1 0
@@ -94,12 +119,6 @@ FUSEOPT_DISABLERESET = -U lfuse:w:$(LOW_FUSE):m -U hfuse:w:0x5d:m -U efuse:w:0xf
 #        | +------------------ CKOUT (clock output on CKOUT pin -> disabled)
 #        +-------------------- CKDIV8 (divide clock by 8 -> divide)
 #
-# Fuse low byte (16 MHz):
-# 0xe1 = 1 1 1 0   0 0 0 1
-#        ^ ^ \+/   \--+--/
-#        | |  |       +------- CKSEL 3..0 (clock selection -> Int HF PLL)
-#        | |  +--------------- SUT 1..0 (BOD enabled, fast rising power)
-#        | +------------------ CKOUT (clock output on CKOUT pin -> disabled)
-#        +-------------------- CKDIV8 (divide clock by 8 -> don't divide)
+# NOTE: The ATtiny87 has no PLL clock source, Timonel runs it from the 8 MHz RC oscillator.
 
 ###############################################################################
@@ -43,6 +43,7 @@ function print_help {
     echo "                          (<16>|<8>|<2>|<1>) (<false>|<true>))]";
     echo "       $0 [(-h | --help)]";
     echo "       $0 [(-a | --all)]";    
+    echo "       $0 [(-r | --report) [<CONFIG> ...]]";
     echo "";
     echo "Generates Timonel custom binary images to flash in an AVR microcontroller.";
     echo "";
@@ -58,6 +59,7 @@ function print_help {
     echo "Options:";
     echo "  -h --help   Prints this help.";
     echo "  -a --all    Generates all Timonel configurations.";    
+    echo "  -r --report Prints the flash size report of the given (or all) configurations.";
     echo "";
     echo "Examples:";
     echo "";
@@ -76,6 +78,99 @@ function print_help {
     echo "  assigning TWI address 17 to the device, setting 0x1B00 device memory position";
     echo "  as bootloader start, setting the device low fuse to operate at 8 MHz";
     echo "  and disabling automatic clock tweaking.";
+    echo "";
+    echo "  $ $0 --report tml-t85-std tml-t85-full > size-report.csv";
+    echo "";
+    echo "  Prints a CSV report with the image size of each configuration, the size";
+    echo "  of each feature, the lowest page-aligned START_ADDR that fits the image";
+    echo "  and the flash bytes left for the application.";
+}
+
+# Builds a configuration with the given make options and prints its image size in bytes
+function image_size {
+    make -s clean_all TARGET=${RPT_TGT} > /dev/null 2>&1;
+    make -s image_size CONFIG=${RPT_CFG} TARGET=${RPT_TGT} $@ 2> /dev/null;
+}
+
+# Prints the size report of a configuration as "config,record,value" CSV rows:
+# - image: bootloader bytes (.text + .data) at the configured TIMONEL_START.
+# - feature.<OPTION>: bytes that the option adds to the image when it's true. It's
+#   measured flipping the option alone, so it's "n/a" when the flipped option doesn't
+#   build with the rest of the configuration (e.g. it needs another feature).
+# - timonel_start: TIMONEL_START set in the configuration.
+# - min_start: lowest page-aligned TIMONEL_START that fits the image in the flash.
+# - app_free: application bytes with the bootloader at min_start. It leaves out the
+#   trampoline page when AUTO_PAGE_ADDR is enabled and APP_USE_TPL_PG isn't.
+function size_report {
+    RPT_CFG=$1;
+    RPT_TGT="tml-size-report";
+    CFG_MAK="./${CFG_DIR}/${RPT_CFG}/${TML_CFG}";
+    if [ ! -f "${CFG_MAK}" ]; then
+        echo "Configuration \"${RPT_CFG}\" not found in \"${CFG_DIR}\" directory!" >&2;
+        return 1;
+    fi
+    cfg_value() {
+        sed -n "s/^$1[ \t]*=[ \t]*\([^ \t#]*\).*/\1/p" ${CFG_MAK} | tail -n 1;
+    }
+    case $(cfg_value MCU) in
+        attiny25|attiny24)
+            FLASH_SIZE=2048;
+            PAGE_SIZE=32;
+            ;;
+        attiny45|attiny44)
+            FLASH_SIZE=4096;
+            PAGE_SIZE=64;
+            ;;
+        attiny87)
+            FLASH_SIZE=8192;
+            PAGE_SIZE=128;
+            ;;
+        *)
+            FLASH_SIZE=8192;
+            PAGE_SIZE=64;
+            ;;
+    esac
+    BASE_SIZE=$(image_size);
+    if [ -z "${BASE_SIZE}" ]; then
+        echo "Configuration \"${RPT_CFG}\" doesn't build!" >&2;
+        return 1;
+    fi
+    echo "${RPT_CFG},image,${BASE_SIZE}";
+    for OPTION in `sed -n "s/^\([A-Z0-9_]*\)[ \t]*=[ \t]*\(true\|false\).*/\1=\2/p" ${CFG_MAK}`; do
+        case ${OPTION#*=} in
+            true)
+                SIZE_ON=${BASE_SIZE};
+                SIZE_OFF=$(image_size ${OPTION%=*}=false);
+                ;;
+            *)
+                SIZE_ON=$(image_size ${OPTION%=*}=true);
+                SIZE_OFF=${BASE_SIZE};
+                ;;
+        esac
+        if [ -z "${SIZE_ON}" ] || [ -z "${SIZE_OFF}" ]; then
+            echo "${RPT_CFG},feature.${OPTION%=*},n/a";
+        else
+            echo "${RPT_CFG},feature.${OPTION%=*},$((SIZE_ON - SIZE_OFF))";
+        fi
+    done
+    # The image size may change a bit when it's linked at another address (relaxed
+    # calls and jumps), so it's rebuilt at the lowest start found until it fits.
+    MIN_START=$(((FLASH_SIZE - BASE_SIZE) / PAGE_SIZE * PAGE_SIZE));
+    while [ ${MIN_START} -gt 0 ]; do
+        SIZE_AT=$(image_size TIMONEL_START=`printf "%X" ${MIN_START}`);
+        if [ -n "${SIZE_AT}" ] && [ $((MIN_START + SIZE_AT)) -le ${FLASH_SIZE} ]; then
+            break;
+        fi
+        MIN_START=$((MIN_START - PAGE_SIZE));
+    done
+    APP_FREE=${MIN_START};
+    if [ "$(cfg_value AUTO_PAGE_ADDR)" = "true" ] && [ "$(cfg_value APP_USE_TPL_PG)" != "true" ]; then
+        APP_FREE=$((MIN_START - PAGE_SIZE));
+    fi
+    echo "${RPT_CFG},timonel_start,0x$(cfg_value TIMONEL_START)";
+    echo "${RPT_CFG},min_start,0x`printf "%04X" ${MIN_START}`";
+    echo "${RPT_CFG},app_free,${APP_FREE}";
+    make -s clean_all TARGET=${RPT_TGT} > /dev/null 2>&1;
 }
 
 case ${ARG1} in
@@ -98,6 +193,18 @@ case ${ARG1} in
         done
         exit;
         ;;
+    -r|-report|--r|--report)
+        shift;
+        RPT_LIST=$@;
+        if [ -z "${RPT_LIST}" ]; then
+            RPT_LIST=`ls ${CFG_DIR}`;
+        fi
+        echo "config,record,value";
+        for RPT_CFG in ${RPT_LIST}; do
+            size_report ${RPT_CFG};
+        done
+        exit;
+        ;;
     *)
         if [ ! -f "./${CFG_DIR}/${ARG1}/${TML_CFG}" ]; then
             echo "";
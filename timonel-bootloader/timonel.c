@@ -41,16 +41,48 @@
 #error "TIMONEL_START in makefile must be a multiple of chip's pagesize"
 #endif
 
-#if (SPM_PAGESIZE > 64)
-#error "Timonel only supports pagesizes up to 64 bytes"
+#if (SPM_PAGESIZE > 128)
+#error "Timonel only supports pagesizes up to 128 bytes"  // Page indexes and packet lengths are single bytes
 #endif
 
 #if (!(AUTO_PAGE_ADDR) && !(CMD_SETPGADDR))
 #error "If the AUTO_PAGE_ADDR option is disabled, then CMD_SETPGADDR must be enabled in tml-config.h!"
 #endif
 
-#if ((MST_PACKET_SIZE > (TWI_RX_BUFFER_SIZE / 2)) || ((SLV_PACKET_SIZE > (TWI_TX_BUFFER_SIZE / 2))))
-#pragma GCC warning "Don't set transmission data size too high to avoid affecting the TWI reliability!"
+#if ((MST_PACKET_SIZE > SPM_PAGESIZE) || (SPM_PAGESIZE % MST_PACKET_SIZE != 0) || (SLV_PACKET_SIZE > SPM_PAGESIZE))
+#error "MST_PACKET_SIZE must divide SPM_PAGESIZE, and the packet sizes can't be bigger than a flash page!"
+#endif
+
+#if ((!(STREAM_PAGE_FILL && !(CMD_WRITPAGZ)) && ((MST_PACKET_SIZE + 1 + CHECKSUM_SIZE) > TWI_RX_BUFFER_SIZE)) || ((SLV_PACKET_SIZE + 1 + CHECKSUM_SIZE) >= TWI_TX_BUFFER_SIZE))
+#error "The TWI buffers are too small to hold a whole data packet, please increase their size!"
+#endif
+
+#if (EEPROM_BLOCKS && (WRITEEPB_CMDLN > TWI_RX_BUFFER_SIZE))
+#error "The TWI RX buffer is too small to hold a whole WRITEEPB packet, please increase its size!"
+#endif
+
+#if (CMD_GETPGCRC && APP_USE_TPL_PG)
+#error "CMD_GETPGCRC erases each page before writing it, it can't be used along with APP_USE_TPL_PG!"
+#endif
+
+#if (FORCE_ERASE_PG && APP_USE_TPL_PG)
+#error "FORCE_ERASE_PG erases each page before writing it, it can't be used along with APP_USE_TPL_PG!"
+#endif
+
+#if (APP_AB_SLOTS && (APP_USE_TPL_PG || CMD_DELPAGES || !(CMD_SETPGADDR || !(AUTO_PAGE_ADDR))))
+#error "APP_AB_SLOTS needs STPGADDR to write the slots, and it can't be used along with APP_USE_TPL_PG or CMD_DELPAGES!"
+#endif
+
+#if (FAST_RESUME && APP_AB_SLOTS)
+#error "With APP_AB_SLOTS, DELFLASH keeps the active application, FAST_RESUME would skip its exit-to-app countdown!"
+#endif
+
+#if (CMD_PGBURST && !(CMD_SETPGADDR))
+#error "CMD_PGBURST needs the STPGADDR command, please enable CMD_SETPGADDR!"
+#endif
+
+#if (CMD_OSCTUNE && !(AUTO_CLK_TWEAK) && ((LOW_FUSE & 0x0F) != RCOSC_CLK_SRC))
+#error "CMD_OSCTUNE needs the RC oscillator (8 MHz) clock source set in LOW_FUSE, or AUTO_CLK_TWEAK!"
 #endif
 
 #if ((CYCLESTOEXIT > 0) && (CYCLESTOEXIT < 10))
@@ -58,6 +90,7 @@
 #endif
 
 // Bootloader prototypes
+inline static void ProcessCommand(MemPack *p_mem_pack) __attribute__((always_inline));
 inline static void ReceiveEvent(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
 inline static void ResetPrescaler(void) __attribute__((always_inline));
 inline static void RestorePrescaler(void) __attribute__((always_inline));
@@ -67,6 +100,9 @@ inline static void Reply_DELFLASH(MemPack *p_mem_pack) __attribute__((always_inl
 #if (CMD_SETPGADDR || !(AUTO_PAGE_ADDR))
 inline static void Reply_STPGADDR(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
 #endif  // CMD_SETPGADDR || !AUTO_PAGE_ADDR
+#if CMD_PGBURST
+inline static void Reply_STPGBRST(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
+#endif  // CMD_PGBURST
 inline static void Reply_WRITPAGE(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
 #if CMD_READFLASH
 inline static void Reply_READFLSH(const uint8_t *command) __attribute__((always_inline));
@@ -79,6 +115,48 @@ inline static void Reply_READDEVS(void) __attribute__((always_inline));
 inline static void Reply_WRITEEPR(const uint8_t *command) __attribute__((always_inline));
 inline static void Reply_READEEPR(const uint8_t *command) __attribute__((always_inline));
 #endif  // EEPROM_ACCESS
+#if CMD_GETPGCRC
+inline static void Reply_GETPGCRC(const uint8_t *command) __attribute__((always_inline));
+uint16_t CalculateCrc(uint16_t mem_addr, uint16_t length);
+#endif  // CMD_GETPGCRC
+#if CMD_GETWSTAT
+inline static void Reply_GETWSTAT(MemPack *p_mem_pack) __attribute__((always_inline));
+#endif  // CMD_GETWSTAT
+#if CMD_WRITPAGZ
+inline static void Reply_WRITPAGZ(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
+uint8_t ExpandPacket(const uint8_t *z_data, uint8_t z_len, MemPack *p_mem_pack, bool fill);
+#endif  // CMD_WRITPAGZ
+#if CMD_READSTRM
+inline static void Reply_READSTRM(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
+inline static uint8_t ReadStreamByte(MemPack *p_mem_pack) __attribute__((always_inline));
+#endif  // CMD_READSTRM
+#if CMD_GETIMCRC
+inline static void Reply_GETIMCRC(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
+inline static void ImageCrcStep(MemPack *p_mem_pack) __attribute__((always_inline));
+#endif  // CMD_GETIMCRC
+#if CMD_DELPAGES
+inline static void Reply_DELPAGES(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
+#endif  // CMD_DELPAGES
+#if EEPROM_BLOCKS
+inline static void Reply_WRITEEPB(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
+inline static void Reply_READEEPB(const uint8_t *command) __attribute__((always_inline));
+#endif  // EEPROM_BLOCKS
+#if APP_AB_SLOTS
+inline static void Reply_SWITSLOT(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
+inline static uint16_t FlashWord(const uint16_t addr) __attribute__((always_inline));
+inline static uint16_t InactiveSlot(void) __attribute__((always_inline));
+#endif  // APP_AB_SLOTS
+#if CMD_READSTAT
+inline static void Reply_READSTAT(const uint8_t *command) __attribute__((always_inline));
+inline static void CountSlowTicks(void) __attribute__((always_inline));
+#endif  // CMD_READSTAT
+#if CMD_OSCTUNE
+inline static void Reply_TUNEOSCC(const uint8_t *command, MemPack *p_mem_pack) __attribute__((always_inline));
+inline static void StepOscillator(const uint8_t osccal) __attribute__((always_inline));
+#endif  // CMD_OSCTUNE
+#if STREAM_PAGE_FILL
+inline static void StreamPageFill(const uint8_t data_byte, MemPack *p_mem_pack) __attribute__((always_inline));
+#endif  // STREAM_PAGE_FILL
 
 // USI TWI driver prototypes
 void UsiTwiTransmitByte(const uint8_t data_byte);
@@ -114,16 +192,53 @@ int main(void) {
       |    Setup Block    |
       |___________________|
     */
+#if (FAST_RESUME || CMD_READSTAT)
+    uint8_t reset_flags = MCUSR;  // Keep the reset cause to validate the session token and statistics
+#endif                            // FAST_RESUME || CMD_READSTAT
+#if APP_WARM_ENTRY
+    bool warm_entry = (GPIOR0 == WARM_ENTRY_KEY);  // Called by the application, GPIOR0 is cleared by any reset
+    GPIOR0 = 0;
+#endif  // APP_WARM_ENTRY
     MCUSR = 0;  // Disable watchdog
-    WDTCR = ((1 << WDCE) | (1 << WDE));
-    WDTCR = ((1 << WDP2) | (1 << WDP1) | (1 << WDP0));
+    WDT_CTRL_REG = ((1 << WDCE) | (1 << WDE));
+    WDT_CTRL_REG = ((1 << WDP2) | (1 << WDP1) | (1 << WDP0));
     cli();  // Disable interrupts
+    static const fptr_t RunApplication = (const fptr_t)((TIMONEL_START - 2) / 2);  // Pointer to trampoline to app address
+#if FAST_APP_START
+    // Start the application right away, before any clock tweak, unless there is no application
+    // (blank trampoline), the strap pin is tied to ground or the "stay" EEPROM flag is set.
+#if APP_WARM_ENTRY
+    if ((*(const __flash uint8_t *)(TIMONEL_START - 1) != 0xFF) && !warm_entry) {
+#else
+    if (*(const __flash uint8_t *)(TIMONEL_START - 1) != 0xFF) {
+#endif  // APP_WARM_ENTRY
+#if (STAY_PIN >= 0)
+        STAY_PIN_PORT |= (1 << STAY_PIN);  // Enable the strap pin pull-up
+        asm volatile("nop\n\tnop\n\tnop\n\tnop");  // Let the pin voltage rise
+        bool stay_pin = !((STAY_PIN_PIN >> STAY_PIN) & true);
+        STAY_PIN_PORT &= ~(1 << STAY_PIN);  // Leave the pin as it was at reset
+        if (!stay_pin)
+#endif  // STAY_PIN
+#if (STAY_EEP_ADDR >= 0)
+            if (eeprom_read_byte((uint8_t *)(STAY_EEP_ADDR)) != STAY_EEP_FLAG)
+#endif  // STAY_EEP_ADDR
+                RunApplication();
+    }
+#endif  // FAST_APP_START
+#if APP_AUTORUN && (EXIT_TIMEOUT_MS > 0)
+    WDT_CTRL_REG = ((1 << WDIF) | (1 << WDIE));  // Watchdog interrupt mode, 16 ms ticks polled to time the exit
+#endif                                           // APP_AUTORUN && EXIT_TIMEOUT_MS
 #if ENABLE_LED_UI
     LED_UI_DDR |= (1 << LED_UI_PIN);  // Set led pin data direction register for output
 #endif                                // ENABLE_LED_UI
 #if APP_AUTORUN
+#if (EXIT_TIMEOUT_MS > 0)
+    uint16_t exit_delay = ((EXIT_TIMEOUT_MS + WDT_TICK_MS - 1) / WDT_TICK_MS);  // Exit-to-app delay in watchdog ticks
+#else
     uint8_t exit_delay = SHORT_EXIT_DLY;  // Exit-to-app delay when the bootloader isn't initialized
-#endif                                    // APP_AUTORUN
+#endif  // EXIT_TIMEOUT_MS
+    bool exit_to_app = false;
+#endif  // APP_AUTORUN
     uint16_t led_delay = SHORT_LED_DLY;   // Blinking delay when the bootloader isn't initialized
 #if AUTO_CLK_TWEAK                        // Automatic clock tweaking made at run time, based on low fuse value
                                           //#pragma message "AUTO CLOCK TWEAKING SELECTED: Clock adjustments will be made at run time ..."
@@ -163,7 +278,6 @@ int main(void) {
     UsiTwiDriverInit();                                                            // Initialize the TWI driver
     __SPM_REG = (_BV(CTPB) | _BV(__SPM_ENABLE));                                   // Prepare to clear the temporary page buffer
     asm volatile("spm");                                                           // Run SPM instruction to complete the clearing
-    static const fptr_t RunApplication = (const fptr_t)((TIMONEL_START - 2) / 2);  // Pointer to trampoline to app address
 #if !(USE_WDT_RESET)
     static const fptr_t RestartTimonel = (const fptr_t)(TIMONEL_START / 2);  // Pointer to bootloader start address
 #endif                                                                       // !USE_WDT_RESET
@@ -177,6 +291,56 @@ int main(void) {
     p_mem_pack->app_reset_lsb = 0x00;
     p_mem_pack->app_reset_msb = 0x00;
 #endif  // AUTO_PAGE_ADDR
+#if STREAM_PAGE_FILL
+    p_mem_pack->stream_ix = 0;
+#endif  // STREAM_PAGE_FILL
+#if CMD_READSTRM
+    p_mem_pack->rd_stm_len = 0;
+#endif  // CMD_READSTRM
+#if CMD_DELPAGES
+    p_mem_pack->del_page_count = 0;
+#endif  // CMD_DELPAGES
+#if CMD_PGBURST
+    p_mem_pack->burst_count = 0;
+#endif  // CMD_PGBURST
+#if CMD_OSCTUNE
+    p_mem_pack->osc_target = OSCCAL;  // Start from the OSC_FAST setting
+    p_mem_pack->osc_safe = OSCCAL;
+    p_mem_pack->osc_trial = 0;
+#endif  // CMD_OSCTUNE
+#if CMD_GETIMCRC
+    p_mem_pack->crc_len = 0;
+    p_mem_pack->crc_ix = 0;
+#endif  // CMD_GETIMCRC
+#if EEPROM_BLOCKS
+    p_mem_pack->eep_len = 0;
+#endif  // EEPROM_BLOCKS
+#if CMD_READSTAT
+    if ((run_stats.magic != STATS_MAGIC) || (reset_flags & ((1 << PORF) | (1 << BORF)))) {
+        // The SRAM contents aren't reliable after a power-on or brown-out reset, start counting again
+        run_stats = (RunStats){.magic = STATS_MAGIC};
+    }
+    run_stats.reset_flags = reset_flags;
+    run_stats.restarts++;
+    TCCR0B = TMR0_CLK_1024;  // Timer 0 times the slow-ops, one tick each STATS_TICK_CLKS cycles
+#endif                                     // CMD_READSTAT
+#if FAST_RESUME
+    // Only the DELFLASH restarts are accepted: a watchdog reset, or the jump to Timonel start,
+    // which finds MCUSR already cleared. The application can leave the token in its RAM, but
+    // hardly along with its complement.
+    if ((session_token == SESSION_TOKEN) && (session_check == (uint16_t)~SESSION_TOKEN) &&
+        ((reset_flags == 0) || (reset_flags == (1 << WDRF)))) {
+        // Restarted by DELFLASH: resume the session, already initialized
+        p_mem_pack->flags = ((1 << FL_INIT_1) | (1 << FL_INIT_2));
+    }
+    session_token = session_check = 0;  // The token is valid for one restart only
+#endif                  // FAST_RESUME
+#if APP_WARM_ENTRY
+    if (warm_entry) {
+        // Entered from the application: start already initialized
+        p_mem_pack->flags = ((1 << FL_INIT_1) | (1 << FL_INIT_2));
+    }
+#endif  // APP_WARM_ENTRY
     /* ___________________
       |                   | 
       |     Main Loop     |
@@ -192,6 +356,22 @@ int main(void) {
         if (((USISR >> TWI_START_COND_FLAG) & true) && ((USICR >> TWI_START_COND_INT) & true)) {
             // If so, run the USI start handler ...
             TwiStartHandler();
+#if STREAM_PAGE_FILL
+            if ((p_mem_pack->stream_ix > 0) && (rx_byte_count < (1 + CHECKSUM_SIZE))) {
+                // A new transfer began before the WRITPAGE packet and its checksum were complete (master
+                // timeout or bus error). Drop it, so the bytes that follow aren't streamed into the page,
+                // and restart the page as when a packet is rejected.
+                if (p_mem_pack->stream_ix > 1) {
+                    boot_temp_buff_erase();
+                    p_mem_pack->page_ix = 0;
+#if CMD_GETWSTAT
+                    p_mem_pack->flags |= (1 << FL_WRT_ERROR);
+#endif  // CMD_GETWSTAT
+                }
+                p_mem_pack->stream_ix = 0;
+                rx_tail = rx_head = rx_byte_count = 0;
+            }
+#endif  // STREAM_PAGE_FILL
         }
         /*......................................................
           . USI TWI INTERRUPT EMULATION [ OVERFLOW ]            .
@@ -203,6 +383,37 @@ int main(void) {
             // If so, run the USI overflow handler ...
             slow_ops_enabled = UsiOverflowHandler(p_mem_pack);
         }
+#if TWI_FAST_POLL
+        // While a transfer is in progress (overflows enabled, no stop condition yet), go back to
+        // polling the USI flags right away. The rest of the loop runs only when the bus is idle.
+        if (((USICR >> USI_OVERFLOW_INT) & true) && !((USISR >> TWI_STOP_COND_FLAG) & true)) {
+            continue;
+        }
+#endif  // TWI_FAST_POLL
+#if TWI_BROADCAST
+        /*......................................................
+          . GENERAL CALL COMMAND PROCESSING                     .
+          . When a command written to the general call address  .
+          . ends with a stop condition, run it without replying  .
+          ......................................................
+        */
+        if (((p_mem_pack->flags >> FL_BROADCAST) & true) && ((USISR >> TWI_STOP_COND_FLAG) & true)) {
+#if CMD_READSTAT
+            run_stats.broadcasts++;
+#endif  // CMD_READSTAT
+            ProcessCommand(p_mem_pack);
+            p_mem_pack->flags &= ~(1 << FL_BROADCAST);  // Cleared after running it, WRITPAGE checks it
+            tx_tail = tx_head;        // Discard the reply, general call commands are never answered
+            slow_ops_enabled = true;  // There is no reply handshake, enable slow operations now
+        }
+#endif  // TWI_BROADCAST
+#if CMD_GETIMCRC
+        if (p_mem_pack->crc_ix < p_mem_pack->crc_len) {
+            // Calculate the GETIMCRC range a few bytes each loop cycle, so the TWI
+            // transfers are served meanwhile, without stretching the clock for long.
+            ImageCrcStep(p_mem_pack);
+        }
+#endif  // CMD_GETIMCRC
         /*..............................
           :                             .
           :   Bootloader initialized     .
@@ -214,6 +425,16 @@ int main(void) {
 #else
         if (((p_mem_pack->flags >> FL_INIT_1) & true) && ((p_mem_pack->flags >> FL_INIT_2) & true)) {
 #endif  // TWO_STEP_INIT
+#if CMD_OSCTUNE
+            if ((p_mem_pack->osc_trial > 0) && ((WDT_CTRL_REG >> WDIF) & true)) {
+                WDT_CTRL_REG = ((1 << WDIF) | (1 << WDIE));  // Clear the tick flag
+                if (--p_mem_pack->osc_trial == 0) {
+                    // The trial setting wasn't confirmed in time, the master may have lost the bus with it
+                    p_mem_pack->osc_target = p_mem_pack->osc_safe;
+                    StepOscillator(p_mem_pack->osc_safe);
+                }
+            }
+#endif  // CMD_OSCTUNE
             /*....................
               :                   .
               :     Slow-Ops       .
@@ -222,6 +443,10 @@ int main(void) {
             */
             if (slow_ops_enabled == true) {
                 slow_ops_enabled = false;
+#if CMD_READSTAT
+                TCNT0 = 0;  // Start timing the slow-ops
+                TMR0_FLAG_REG = (1 << TOV0);
+#endif  // CMD_READSTAT
                 // =========================================================
                 // = Exit the bootloader & run the application (Slow-Op 1) =
                 // =========================================================
@@ -244,6 +469,19 @@ int main(void) {
                     RestorePrescaler();       // Restore prescaler factor to divide by 8
 #endif                                 // PRESCALER BIT
 #endif                                 // AUTO_CLK_TWEAK
+#if (APP_AUTORUN && (EXIT_TIMEOUT_MS > 0)) || CMD_OSCTUNE
+                    WDT_CTRL_REG = (1 << WDIF);  // Stop the exit timer or trial ticks
+#endif                                           // (APP_AUTORUN && EXIT_TIMEOUT_MS) || CMD_OSCTUNE
+#if CMD_READSTAT
+                    TCCR0B = 0;  // Stop timer 0 and clear it, the application finds it as after reset
+                    TCNT0 = 0;
+                    TMR0_FLAG_REG = (1 << TOV0);
+#endif  // CMD_READSTAT
+#if FAST_APP_START && (STAY_EEP_ADDR >= 0)
+                    if (eeprom_read_byte((uint8_t *)(STAY_EEP_ADDR)) == STAY_EEP_FLAG) {
+                        eeprom_write_byte((uint8_t *)(STAY_EEP_ADDR), 0xFF);  // Clear the "stay" flag
+                    }
+#endif                                 // FAST_APP_START && STAY_EEP_ADDR
                     RunApplication();  // Exit to the application
                 }
                 // ==================================================
@@ -253,10 +491,23 @@ int main(void) {
 #if ENABLE_LED_UI
                     LED_UI_PORT |= (1 << LED_UI_PIN);  // Turn led on to indicate erasing ...
 #endif                                                 // ENABLE_LED_UI
+#if CMD_READSTAT
+                    run_stats.del_flash++;
+#endif  // CMD_READSTAT
+#if APP_AB_SLOTS
+                    // Erase only the inactive slot, the active application is kept
+                    uint16_t slot_start = InactiveSlot();
+                    uint16_t page_to_del = (slot_start + SLOT_SIZE);
+                    while (page_to_del != slot_start) {
+#else
                     uint16_t page_to_del = TIMONEL_START;
                     while (page_to_del != RESET_PAGE) {
+#endif  // APP_AB_SLOTS
                         page_to_del -= SPM_PAGESIZE;
                         boot_page_erase(page_to_del);  // Erase flash memory ...
+#if CMD_READSTAT
+                        CountSlowTicks();
+#endif  // CMD_READSTAT
                     }
 #if AUTO_CLK_TWEAK
                     if ((boot_lock_fuse_bits_get(GET_LOW_FUSE_BITS) & 0x0F) == RCOSC_CLK_SRC) {
@@ -267,9 +518,16 @@ int main(void) {
                     OSCCAL = factory_osccal;  // Back the oscillator calibration to its original setting
 #endif  // LOW_FUSE RC OSC
 #endif  // AUTO_CLK_TWEAK
+#if FAST_RESUME
+                    session_token = SESSION_TOKEN;  // Come back initialized after the restart
+                    session_check = ~SESSION_TOKEN;
+#endif                                              // FAST_RESUME
 #if !(USE_WDT_RESET)
                     RestartTimonel();  // Restart by jumping to Timonel start
 #else
+#if (APP_AUTORUN && (EXIT_TIMEOUT_MS > 0)) || CMD_OSCTUNE
+                    WDT_CTRL_REG = (1 << WDIF);  // Leave the interrupt mode, so the watchdog timeout resets the device
+#endif                                           // (APP_AUTORUN && EXIT_TIMEOUT_MS) || CMD_OSCTUNE
                     wdt_enable(WDTO_15MS);    // Restart by activating the watchdog timer
                     for (;;) {
                     };
@@ -278,7 +536,9 @@ int main(void) {
                 // ===========================================================================
                 // = Write the received page to memory and prepare for a new one (Slow-Op 3) =
                 // ===========================================================================
-#if (APP_USE_TPL_PG || !(AUTO_PAGE_ADDR))
+#if APP_AB_SLOTS
+                if ((p_mem_pack->page_ix == SPM_PAGESIZE) && ((uint16_t)(p_mem_pack->page_addr - InactiveSlot()) < SLOT_SIZE)) {
+#elif (APP_USE_TPL_PG || !(AUTO_PAGE_ADDR))
                 if ((p_mem_pack->page_ix == SPM_PAGESIZE) && (p_mem_pack->page_addr < TIMONEL_START)) {
 #else
                 if ((p_mem_pack->page_ix == SPM_PAGESIZE) && (p_mem_pack->page_addr < TIMONEL_START - SPM_PAGESIZE)) {
@@ -286,19 +546,27 @@ int main(void) {
 #if ENABLE_LED_UI
                     LED_UI_PORT ^= (1 << LED_UI_PIN);  // Turn led on and off to indicate writing ...
 #endif                                                 // ENABLE_LED_UI
-#if FORCE_ERASE_PG
-                    boot_page_erase(p_mem_pack->page_addr);
-#endif  // FORCE_ERASE_PG
+#if (FORCE_ERASE_PG || CMD_GETPGCRC || APP_AB_SLOTS)
+                    boot_page_erase(p_mem_pack->page_addr);  // Erase only the page to be written
+#endif  // FORCE_ERASE_PG || CMD_GETPGCRC || APP_AB_SLOTS
                     boot_page_write(p_mem_pack->page_addr);
+#if CMD_READSTAT
+                    run_stats.pages++;
+#endif  // CMD_READSTAT
 #if AUTO_PAGE_ADDR
+#if !(APP_AB_SLOTS)
                     if (p_mem_pack->page_addr == RESET_PAGE) {  // Calculate and write trampoline
                         uint16_t tpl = (((~((TIMONEL_START >> 1) - ((((p_mem_pack->app_reset_msb << 8) | p_mem_pack->app_reset_lsb) + 1) & 0x0FFF)) + 1) & 0x0FFF) | 0xC000);
+#if (FORCE_ERASE_PG || CMD_GETPGCRC)
+                        boot_page_erase(TIMONEL_START - SPM_PAGESIZE);  // Erase the trampoline page
+#endif  // FORCE_ERASE_PG || CMD_GETPGCRC
                         for (int i = 0; i < SPM_PAGESIZE - 2; i += 2) {
                             boot_page_fill((TIMONEL_START - SPM_PAGESIZE) + i, 0xFFFF);
                         }
                         boot_page_fill((TIMONEL_START - 2), tpl);
                         boot_page_write(TIMONEL_START - SPM_PAGESIZE);
                     }
+#endif  // !APP_AB_SLOTS
 #if APP_USE_TPL_PG
                     if (p_mem_pack->page_addr == (TIMONEL_START - SPM_PAGESIZE)) {
                         uint16_t tpl = (((~((TIMONEL_START >> 1) - ((((p_mem_pack->app_reset_msb << 8) | p_mem_pack->app_reset_lsb) + 1) & 0x0FFF)) + 1) & 0x0FFF) | 0xC000);
@@ -322,8 +590,110 @@ int main(void) {
 #endif  // APP_USE_TPL_PG
                     p_mem_pack->page_addr += SPM_PAGESIZE;
 #endif  // AUTO_PAGE_ADDR
+#if (CMD_PGBURST && !(AUTO_PAGE_ADDR))
+                    if (p_mem_pack->burst_count > 0) {
+                        p_mem_pack->burst_count--;
+                        p_mem_pack->page_addr += SPM_PAGESIZE;  // The next WRITPAGE packets fill the next burst page
+                    }
+#endif  // CMD_PGBURST && !AUTO_PAGE_ADDR
+                    p_mem_pack->page_ix = 0;
+                }
+#if CMD_DELPAGES
+                // ==================================================
+                // = Delete a range of application pages (Slow-Op 4) =
+                // ==================================================
+                if (p_mem_pack->del_page_count > 0) {
+#if ENABLE_LED_UI
+                    LED_UI_PORT |= (1 << LED_UI_PIN);  // Turn led on to indicate erasing ...
+#endif                                                 // ENABLE_LED_UI
+                    // Any page being filled is dropped, the temporary page buffer is needed below
+                    boot_temp_buff_erase();
+                    p_mem_pack->page_ix = 0;
+                    // Keep the trampoline if the application is allowed to use its page
+                    const __flash uint8_t *mem_position;
+                    mem_position = (void *)(TIMONEL_START - 2);
+                    uint16_t tpl = (*mem_position & 0xFF);
+                    tpl += ((*(++mem_position) & 0xFF) << 8);
+                    while (p_mem_pack->del_page_count-- > 0) {
+                        boot_page_erase(p_mem_pack->del_page_addr);  // Erase flash memory ...
+                        if (p_mem_pack->del_page_addr == RESET_PAGE) {
+                            // Point the reset vector to this bootloader again, as Reply_WRITPAGE does
+                            boot_page_fill(RESET_PAGE, (0xC000 + ((TIMONEL_START / 2) - 1)));
+                            boot_page_write(RESET_PAGE);
+                        }
+                        if (p_mem_pack->del_page_addr == (TIMONEL_START - SPM_PAGESIZE)) {
+                            boot_page_fill((TIMONEL_START - 2), tpl);  // Restore the trampoline
+                            boot_page_write(TIMONEL_START - SPM_PAGESIZE);
+                        }
+                        p_mem_pack->del_page_addr += SPM_PAGESIZE;
+#if CMD_READSTAT
+                        CountSlowTicks();
+#endif  // CMD_READSTAT
+                    }
+                    p_mem_pack->del_page_count = 0;
+#if ENABLE_LED_UI
+                    LED_UI_PORT &= ~(1 << LED_UI_PIN);  // Turn led off when done
+#endif                                                  // ENABLE_LED_UI
+                }
+#endif  // CMD_DELPAGES
+#if EEPROM_BLOCKS
+                // ===================================================
+                // = Write the received EEPROM data block (Slow-Op 5) =
+                // ===================================================
+                // Each byte takes 3.4 ms to write, unless it already holds the value
+                while (p_mem_pack->eep_len > 0) {
+                    eeprom_update_byte((uint8_t *)(p_mem_pack->eep_addr++ & E2END), *(p_mem_pack->eep_data++));
+                    p_mem_pack->eep_len--;
+#if CMD_READSTAT
+                    CountSlowTicks();
+#endif  // CMD_READSTAT
+                }
+#endif  // EEPROM_BLOCKS
+#if APP_AB_SLOTS
+                // ====================================================
+                // = Switch the active application slot (Slow-Op 6)  =
+                // ====================================================
+                if ((p_mem_pack->flags >> FL_SWITCH_SLOT) & true) {
+                    p_mem_pack->flags &= ~(1 << FL_SWITCH_SLOT);
+                    // Any page being filled is dropped, the temporary page buffer is needed below
+                    boot_temp_buff_erase();
                     p_mem_pack->page_ix = 0;
+                    // Page 0 points the reset vector to Timonel and forwards the other interrupt
+                    // vectors to the trampoline page. It never changes, so it's written only once.
+                    bool vectors_ok = true;
+                    for (uint8_t i = 0; i < SPM_PAGESIZE; i += 2) {
+                        uint16_t vector = ((i == 0) ? RJMP(RESET_PAGE, TIMONEL_START) : RJMP(i, (TPL_PAGE + i)));
+                        if (FlashWord(RESET_PAGE + i) != vector) {
+                            vectors_ok = false;
+                        }
+                        boot_page_fill((RESET_PAGE + i), vector);
+                    }
+                    if (vectors_ok) {
+                        boot_temp_buff_erase();
+                    } else {
+                        boot_page_erase(RESET_PAGE);
+                        boot_page_write(RESET_PAGE);
+                    }
+                    // The trampoline page forwards the interrupt vectors to the new slot ones and its last
+                    // word is the trampoline to the slot reset vector: writing it commits the switch.
+                    uint16_t slot_start = (((p_mem_pack->flags >> FL_SLOT_B) & true) ? SLOT_B_START : SLOT_A_START);
+                    for (uint8_t i = 0; i < SPM_PAGESIZE - 2; i += 2) {
+                        boot_page_fill((TPL_PAGE + i), RJMP((TPL_PAGE + i), (slot_start + i)));
+                    }
+                    boot_page_fill((TIMONEL_START - 2), RJMP((TIMONEL_START - 2), slot_start));
+                    boot_page_erase(TPL_PAGE);
+                    boot_page_write(TPL_PAGE);
                 }
+#endif  // APP_AB_SLOTS
+#if CMD_OSCTUNE
+                // ====================================================
+                // = Step the oscillator to its setting (Slow-Op 7)   =
+                // ====================================================
+                StepOscillator(p_mem_pack->osc_target);
+#endif  // CMD_OSCTUNE
+#if CMD_READSTAT
+                CountSlowTicks();
+#endif  // CMD_READSTAT
             }
         /*..................................
           :                                 .
@@ -332,39 +702,94 @@ int main(void) {
           :.................................
         */
         } else {
+#if APP_AUTORUN && (EXIT_TIMEOUT_MS > 0)
+            if ((WDT_CTRL_REG >> WDIF) & true) {
+                WDT_CTRL_REG = ((1 << WDIF) | (1 << WDIE));  // Clear the tick flag
+                if (--exit_delay == 0) {
+                    exit_to_app = true;  // Count EXIT_TIMEOUT_MS down in watchdog ticks
+                }
+            }
+#endif  // APP_AUTORUN && EXIT_TIMEOUT_MS
             if (led_delay-- == 0) {
 #if ENABLE_LED_UI
                 LED_UI_PORT ^= (1 << LED_UI_PIN);  // If Timonel isn't initialized, led blinks at LED_DLY intervals
 #endif                                             // ENABLE_LED_UI
-#if APP_AUTORUN
+#if APP_AUTORUN && !(EXIT_TIMEOUT_MS > 0)
                 if (exit_delay-- == 0) {
-                    // ========================================
-                    // = >>> Timeout: Run the application <<< =
-                    // ========================================
+                    exit_to_app = true;  // Count from SHORT_EXIT_DLY to 0 led delays
+                }
+#endif  // APP_AUTORUN && !EXIT_TIMEOUT_MS
+            }
+#if APP_AUTORUN
+            if (exit_to_app == true) {
+                // ========================================
+                // = >>> Timeout: Run the application <<< =
+                // ========================================
 #if AUTO_CLK_TWEAK
-                    if ((boot_lock_fuse_bits_get(GET_LOW_FUSE_BITS) & 0x0F) == RCOSC_CLK_SRC) {
-                        OSCCAL = factory_osccal;  // Back the oscillator calibration to its original setting
-                    }
-                    if (!((boot_lock_fuse_bits_get(GET_LOW_FUSE_BITS) >> LFUSE_PRESC_BIT) & true)) {
-                        RestorePrescaler();  // Restore prescaler to divide by 8
-                    }
-#else
-#if ((LOW_FUSE & 0x0F) == RCOSC_CLK_SRC)
+                if ((boot_lock_fuse_bits_get(GET_LOW_FUSE_BITS) & 0x0F) == RCOSC_CLK_SRC) {
                     OSCCAL = factory_osccal;  // Back the oscillator calibration to its original setting
-#endif                                 // LOW_FUSE & 0x0F
-#if ((LOW_FUSE & 0x80) == 0)           // Prescaler dividing clock by 8
-                    RestorePrescaler();       // Restore prescaler factor to divide by 8
-#endif                                 // LOW_FUSE & 0x80
-#endif                                 // AUTO_CLK_TWEAK
-                    RunApplication();  // Count from CYCLESTOEXIT to 0, then exit to the application
                 }
-#endif  // APP_AUTORUN
+                if (!((boot_lock_fuse_bits_get(GET_LOW_FUSE_BITS) >> LFUSE_PRESC_BIT) & true)) {
+                    RestorePrescaler();  // Restore prescaler to divide by 8
+                }
+#else
+#if ((LOW_FUSE & 0x0F) == RCOSC_CLK_SRC)
+                OSCCAL = factory_osccal;  // Back the oscillator calibration to its original setting
+#endif                                // LOW_FUSE & 0x0F
+#if ((LOW_FUSE & 0x80) == 0)          // Prescaler dividing clock by 8
+                RestorePrescaler();   // Restore prescaler factor to divide by 8
+#endif                                // LOW_FUSE & 0x80
+#endif                                // AUTO_CLK_TWEAK
+#if (EXIT_TIMEOUT_MS > 0) || CMD_OSCTUNE
+                WDT_CTRL_REG = (1 << WDIF);  // Stop the exit timer or trial ticks
+#endif                                       // EXIT_TIMEOUT_MS || CMD_OSCTUNE
+#if CMD_READSTAT
+                TCCR0B = 0;  // Stop timer 0 and clear it, the application finds it as after reset
+                TCNT0 = 0;
+                TMR0_FLAG_REG = (1 << TOV0);
+#endif                     // CMD_READSTAT
+                RunApplication();  // Exit to the application
             }
+#endif  // APP_AUTORUN
         }
     }
     return 0;
 }
 
+/* __________________________
+  |                          |
+  |  Received command fetch  |
+  |__________________________|
+*/
+inline void ProcessCommand(MemPack *p_mem_pack) {
+    // Read the receive buffer, then call "ReceiveEvent" to process the received command and send the reply
+    uint8_t command_size = rx_byte_count;
+    static uint8_t command[TWI_RX_BUFFER_SIZE];
+#if CMD_READSTRM
+    if (command_size == 0) {
+        if (p_mem_pack->rd_stm_len > 0) {
+            return;  // A read transfer without a new command continues the READSTRM stream
+        }
+    } else {
+        p_mem_pack->rd_stm_len = 0;  // Any new command ends the READSTRM stream
+    }
+#endif  // CMD_READSTRM
+#if EEPROM_BLOCKS
+    // A WRITEEPB block whose reply handshake didn't complete is dropped here: its data
+    // bytes are kept in the command buffer, which is about to be overwritten.
+    p_mem_pack->eep_len = 0;
+#endif  // EEPROM_BLOCKS
+    for (uint8_t i = 0; i < command_size; i++) {
+        rx_tail = ((rx_tail + 1) & TWI_RX_BUFFER_MASK);
+        rx_byte_count--;
+        command[i] = rx_buffer[rx_tail];
+    }
+    ReceiveEvent(command, p_mem_pack);
+#if STREAM_PAGE_FILL
+    p_mem_pack->stream_ix = 0;  // End the WRITPAGE data stream
+#endif  // STREAM_PAGE_FILL
+}
+
 /* __________________________
   |                          |
   |  TWI data receive event  |
@@ -390,6 +815,12 @@ inline void ReceiveEvent(const uint8_t *command, MemPack *p_mem_pack) {
             return;
         }
 #endif  // CMD_SETPGADDR || !AUTO_PAGE_ADDR
+#if CMD_PGBURST
+        case STPGBRST: {
+            Reply_STPGBRST(command, p_mem_pack);
+            return;
+        }
+#endif  // CMD_PGBURST
         case WRITPAGE: {
             Reply_WRITPAGE(command, p_mem_pack);
             return;
@@ -422,6 +853,70 @@ inline void ReceiveEvent(const uint8_t *command, MemPack *p_mem_pack) {
             return;
         }        
 #endif  // EEPROM_ACCESS
+#if CMD_GETPGCRC
+        case GETPGCRC: {
+            Reply_GETPGCRC(command);
+            return;
+        }
+#endif  // CMD_GETPGCRC
+#if CMD_GETWSTAT
+        case GETWSTAT: {
+            Reply_GETWSTAT(p_mem_pack);
+            return;
+        }
+#endif  // CMD_GETWSTAT
+#if CMD_WRITPAGZ
+        case WRITPAGZ: {
+            Reply_WRITPAGZ(command, p_mem_pack);
+            return;
+        }
+#endif  // CMD_WRITPAGZ
+#if CMD_READSTRM
+        case READSTRM: {
+            Reply_READSTRM(command, p_mem_pack);
+            return;
+        }
+#endif  // CMD_READSTRM
+#if CMD_GETIMCRC
+        case GETIMCRC: {
+            Reply_GETIMCRC(command, p_mem_pack);
+            return;
+        }
+#endif  // CMD_GETIMCRC
+#if CMD_DELPAGES
+        case DELPAGES: {
+            Reply_DELPAGES(command, p_mem_pack);
+            return;
+        }
+#endif  // CMD_DELPAGES
+#if EEPROM_BLOCKS
+        case WRITEEPB: {
+            Reply_WRITEEPB(command, p_mem_pack);
+            return;
+        }
+        case READEEPB: {
+            Reply_READEEPB(command);
+            return;
+        }
+#endif  // EEPROM_BLOCKS
+#if APP_AB_SLOTS
+        case SWITSLOT: {
+            Reply_SWITSLOT(command, p_mem_pack);
+            return;
+        }
+#endif  // APP_AB_SLOTS
+#if CMD_READSTAT
+        case READSTAT: {
+            Reply_READSTAT(command);
+            return;
+        }
+#endif  // CMD_READSTAT
+#if CMD_OSCTUNE
+        case TUNEOSCC: {
+            Reply_TUNEOSCC(command, p_mem_pack);
+            return;
+        }
+#endif  // CMD_OSCTUNE
         default: {
             UsiTwiTransmitByte(UNKNOWNC);
         }
@@ -489,6 +984,11 @@ inline void Reply_STPGADDR(const uint8_t *command, MemPack *p_mem_pack) {
     uint8_t reply[STPGADDR_RPLYLN] = {0};
     p_mem_pack->page_addr = ((command[1] << 8) + command[2]);  // Sets the flash memory page base address
     p_mem_pack->page_addr &= ~(SPM_PAGESIZE - 1);              // Keep only pages' base addresses
+    p_mem_pack->page_ix = 0;  // Start the page from its first packet, even after a half-written one
+    boot_temp_buff_erase();
+#if CMD_PGBURST
+    p_mem_pack->burst_count = 0;  // A single page address ends any burst
+#endif                            // CMD_PGBURST
     reply[0] = AKPGADDR;
     reply[1] = (uint8_t)(command[1] + command[2]);  // Returns the sum of MSB and LSB of the page address
     for (uint8_t i = 0; i < STPGADDR_RPLYLN; i++) {
@@ -497,6 +997,28 @@ inline void Reply_STPGADDR(const uint8_t *command, MemPack *p_mem_pack) {
 }
 #endif  // (CMD_SETPGADDR || !AUTO_PAGE_ADDR)
 
+#if CMD_PGBURST
+/* ____________________
+  |                    |
+  |   Reply_STPGBRST   |
+  |____________________|
+*/
+inline void Reply_STPGBRST(const uint8_t *command, MemPack *p_mem_pack) {
+    // Command: STPGBRST, first page address MSB, first page address LSB, page count
+    uint8_t reply[STPGBRST_RPLYLN] = {0};
+    p_mem_pack->page_addr = ((command[1] << 8) + command[2]);  // Sets the first flash memory page base address
+    p_mem_pack->page_addr &= ~(SPM_PAGESIZE - 1);              // Keep only pages' base addresses
+    p_mem_pack->burst_count = command[3];                      // With AUTO_PAGE_ADDR, the address always advances
+    p_mem_pack->page_ix = 0;                                   // Start the page from its first packet (see STPGADDR)
+    boot_temp_buff_erase();
+    reply[0] = AKPGBRST;
+    reply[1] = (uint8_t)(command[1] + command[2] + command[3]);  // Returns the sum of the address bytes and the count
+    for (uint8_t i = 0; i < STPGBRST_RPLYLN; i++) {
+        UsiTwiTransmitByte(reply[i]);
+    }
+}
+#endif  // CMD_PGBURST
+
 /* ____________________
   |                    |
   |   Reply_WRITPAGE   |
@@ -505,43 +1027,238 @@ inline void Reply_STPGADDR(const uint8_t *command, MemPack *p_mem_pack) {
 inline void Reply_WRITPAGE(const uint8_t *command, MemPack *p_mem_pack) {
     uint8_t reply[WRITPAGE_RPLYLN] = {0};
     reply[0] = ACKWTPAG;
-    if ((p_mem_pack->page_addr + p_mem_pack->page_ix) == RESET_PAGE) {
+#if (TWI_BROADCAST && !(STREAM_PAGE_FILL))
+    if (((p_mem_pack->flags >> FL_BROADCAST) & true) && (p_mem_pack->page_ix == 0)) {
+        boot_temp_buff_erase();  // Start each general call page from a clean buffer
+    }
+#endif  // TWI_BROADCAST && !STREAM_PAGE_FILL
+#if STREAM_PAGE_FILL
+    // The packet data is already in the temporary page buffer and its checksum was
+    // computed while receiving it, the command only carries the master's checksum.
+#if USE_CRC16
+    reply[1] = (uint8_t)(p_mem_pack->stream_chk >> 8);
+    reply[2] = (uint8_t)(p_mem_pack->stream_chk & 0xFF);
+    bool packet_ok = ((reply[1] == command[1]) && (reply[2] == command[2]));
+#else
+    reply[1] = p_mem_pack->stream_chk;
+    bool packet_ok = (reply[1] == command[1]);
+#endif  // USE_CRC16
+    if (p_mem_pack->stream_ix != (MST_PACKET_SIZE + 1)) {
+        packet_ok = false;  // Incomplete packet
+    }
+#else
+    // The packet is checked before filling the temporary page buffer, since the
+    // buffer positions can't be written twice without clearing the whole buffer.
+#if USE_CRC16
+    uint16_t crc = 0x0000;
+    for (uint8_t i = 1; i < (MST_PACKET_SIZE + 1); i++) {
+        crc = _crc_xmodem_update(crc, command[i]);  // Reply CRC-16 accumulator
+    }
+    reply[1] = (uint8_t)(crc >> 8);
+    reply[2] = (uint8_t)(crc & 0xFF);
+    bool packet_ok = ((reply[1] == command[MST_PACKET_SIZE + 1]) && (reply[2] == command[MST_PACKET_SIZE + 2]));
+#else
+    for (uint8_t i = 1; i < (MST_PACKET_SIZE + 1); i++) {
+        reply[1] += (uint8_t)(command[i]);  // Reply checksum accumulator
+    }
+    bool packet_ok = (reply[1] == command[MST_PACKET_SIZE + 1]);
+#endif  // USE_CRC16
+#endif  // STREAM_PAGE_FILL
+#if CHECK_PAGE_IX
+    if ((p_mem_pack->page_ix + MST_PACKET_SIZE) > SPM_PAGESIZE) {
+        packet_ok = false;
+    }
+#endif  // CHECK_PAGE_IX
+    if (packet_ok) {
+#if STREAM_PAGE_FILL
+        p_mem_pack->page_ix += MST_PACKET_SIZE;
+#else
+        uint8_t i = 1;
+        if ((p_mem_pack->page_addr + p_mem_pack->page_ix) == RESET_PAGE) {
 #if AUTO_PAGE_ADDR
-        p_mem_pack->app_reset_lsb = command[1];
-        p_mem_pack->app_reset_msb = command[2];
+            p_mem_pack->app_reset_lsb = command[1];
+            p_mem_pack->app_reset_msb = command[2];
 #endif  // AUTO_PAGE_ADDR
-        // This section modifies the reset vector to point to this bootloader.
-        // WARNING: This only works when CMD_SETPGADDR is disabled. If CMD_SETPGADDR is enabled,
-        // the reset vector modification MUST BE done by the TWI master's upload program.
-        // Otherwise, Timonel won't have the execution control after power-on reset.
-        boot_page_fill((RESET_PAGE), (0xC000 + ((TIMONEL_START / 2) - 1)));
-        reply[1] += (uint8_t)((command[2]) + command[1]);  // Reply checksum accumulator
-        p_mem_pack->page_ix += 2;
-        for (uint8_t i = 3; i < (MST_PACKET_SIZE + 1); i += 2) {
-            boot_page_fill((p_mem_pack->page_addr + p_mem_pack->page_ix), ((command[i + 1] << 8) | command[i]));
-            reply[1] += (uint8_t)((command[i + 1]) + command[i]);
+            // This section modifies the reset vector to point to this bootloader.
+            // WARNING: This only works when CMD_SETPGADDR is disabled. If CMD_SETPGADDR is enabled,
+            // the reset vector modification MUST BE done by the TWI master's upload program.
+            // Otherwise, Timonel won't have the execution control after power-on reset.
+            boot_page_fill((RESET_PAGE), (0xC000 + ((TIMONEL_START / 2) - 1)));
             p_mem_pack->page_ix += 2;
+            i = 3;
         }
-    } else {
-        for (uint8_t i = 1; i < (MST_PACKET_SIZE + 1); i += 2) {
+        for (; i < (MST_PACKET_SIZE + 1); i += 2) {
             boot_page_fill((p_mem_pack->page_addr + p_mem_pack->page_ix), ((command[i + 1] << 8) | command[i]));
-            reply[1] += (uint8_t)((command[i + 1]) + command[i]);
             p_mem_pack->page_ix += 2;
         }
-    }
-#if CHECK_PAGE_IX
-    if ((reply[1] != command[MST_PACKET_SIZE + 1]) || (p_mem_pack->page_ix > SPM_PAGESIZE)) {
+#endif  // STREAM_PAGE_FILL
+#if CMD_GETWSTAT
+        p_mem_pack->flags &= ~(1 << FL_WRT_ERROR);
+#endif  // CMD_GETWSTAT
+#if WRITPAGE_BUSY
+        if (p_mem_pack->page_ix == SPM_PAGESIZE) {
+            // The page is complete, it will be programmed after this reply. The device doesn't
+            // respond meanwhile, so the master should wait for this time before the next command.
+#if (FORCE_ERASE_PG || CMD_GETPGCRC || APP_AB_SLOTS)
+            reply[WRITPAGE_RPLYLN - 1] = (2 * PAGE_SPM_MS);  // Page erase + write
+#else
+            reply[WRITPAGE_RPLYLN - 1] = PAGE_SPM_MS;  // Page write
+#endif  // FORCE_ERASE_PG || CMD_GETPGCRC || APP_AB_SLOTS
+#if AUTO_PAGE_ADDR
+            if (p_mem_pack->page_addr == RESET_PAGE) {
+                reply[WRITPAGE_RPLYLN - 1] *= 2;  // The trampoline page is also programmed
+            }
+#endif  // AUTO_PAGE_ADDR
+        }
+#endif  // WRITPAGE_BUSY
+    } else {
+#if TWI_BROADCAST
+        uint8_t page_ix = p_mem_pack->page_ix;
+#endif  // TWI_BROADCAST
+#if STREAM_PAGE_FILL
+        // The rejected data was already streamed into the temporary page buffer, so
+        // the buffer is cleared and the master has to resend the page from its start.
+        boot_temp_buff_erase();
+        p_mem_pack->page_ix = 0;
+#endif  // STREAM_PAGE_FILL
+#if TWI_BROADCAST
+        if (((p_mem_pack->flags >> FL_BROADCAST) & true) && ((page_ix + MST_PACKET_SIZE) <= SPM_PAGESIZE)) {
+            // A general call gets no reply, so the packet is skipped to stay in step with the master's
+            // page index. The page is written with a gap, its CRC doesn't match and it's reflashed later.
+            p_mem_pack->page_ix = (page_ix + MST_PACKET_SIZE);
+        }
+#endif  // TWI_BROADCAST
+#if CMD_READSTAT
+        run_stats.rejected++;
+#endif  // CMD_READSTAT
+#if (USE_CRC16 || CMD_GETWSTAT)
+#if STREAM_PAGE_FILL
+        reply[0] = NAKPGRST;  // If checksums don't match, the page buffer was cleared, the master has to resend the page ...
+#else
+        reply[0] = NAKWTPAG;  // If checksums don't match, reject only this packet, the master has to resend it ...
+#endif  // STREAM_PAGE_FILL
+#if CMD_GETWSTAT
+        p_mem_pack->flags |= (1 << FL_WRT_ERROR);
+#endif  // CMD_GETWSTAT
 #else
-    if (reply[1] != command[MST_PACKET_SIZE + 1]) {
-#endif                                             // CHECK_PAGE_IX
         p_mem_pack->flags |= (1 << FL_DEL_FLASH);  // If checksums don't match, safety payload deletion ...
         reply[1] = 0;
+#endif  // USE_CRC16 || CMD_GETWSTAT
     }
     for (uint8_t i = 0; i < WRITPAGE_RPLYLN; i++) {
         UsiTwiTransmitByte(reply[i]);
     }
 }
 
+#if CMD_WRITPAGZ
+/* ____________________
+  |                    |
+  |   Reply_WRITPAGZ   |
+  |____________________|
+*/
+inline void Reply_WRITPAGZ(const uint8_t *command, MemPack *p_mem_pack) {
+    // Command: WRITPAGZ, compressed length, compressed data, checksum of the compressed data
+    uint8_t reply[WRITPAGZ_RPLYLN] = {0};
+    uint8_t z_len = command[1];
+    if (z_len > WRITPAGZ_MAXLN) {
+        z_len = WRITPAGZ_MAXLN;  // The packet will be rejected by checksum
+    }
+    reply[0] = ACKWTPGZ;
+#if USE_CRC16
+    uint16_t crc = 0x0000;
+    for (uint8_t i = 2; i < (z_len + 2); i++) {
+        crc = _crc_xmodem_update(crc, command[i]);  // Reply CRC-16 accumulator
+    }
+    reply[1] = (uint8_t)(crc >> 8);
+    reply[2] = (uint8_t)(crc & 0xFF);
+    bool packet_ok = ((reply[1] == command[z_len + 2]) && (reply[2] == command[z_len + 3]));
+#else
+    for (uint8_t i = 2; i < (z_len + 2); i++) {
+        reply[1] += (uint8_t)(command[i]);  // Reply checksum accumulator
+    }
+    bool packet_ok = (reply[1] == command[z_len + 2]);
+#endif  // USE_CRC16
+    // A first pass gets the expanded size, so the page buffer is only filled with whole valid packets
+    uint8_t data_len = ExpandPacket(&command[2], z_len, p_mem_pack, false);
+    if ((data_len & 0x01) || ((p_mem_pack->page_ix + data_len) > SPM_PAGESIZE)) {
+        packet_ok = false;  // Malformed data, odd size or page overflow
+    }
+    if (packet_ok) {
+        ExpandPacket(&command[2], z_len, p_mem_pack, true);
+        p_mem_pack->page_ix += data_len;
+        reply[WRITPAGZ_RPLYLN - 1] = data_len;  // Returns the amount of bytes written to the page buffer
+#if CMD_GETWSTAT
+        p_mem_pack->flags &= ~(1 << FL_WRT_ERROR);
+#endif  // CMD_GETWSTAT
+    } else {
+        reply[0] = NAKWTPAG;  // Reject only this packet, the master has to resend it ...
+#if CMD_READSTAT
+        run_stats.rejected++;
+#endif  // CMD_READSTAT
+#if CMD_GETWSTAT
+        p_mem_pack->flags |= (1 << FL_WRT_ERROR);
+#endif  // CMD_GETWSTAT
+    }
+    for (uint8_t i = 0; i < WRITPAGZ_RPLYLN; i++) {
+        UsiTwiTransmitByte(reply[i]);
+    }
+}
+
+/* ____________________
+  |                    |
+  |    ExpandPacket    |
+  |____________________|
+*/
+uint8_t ExpandPacket(const uint8_t *z_data, uint8_t z_len, MemPack *p_mem_pack, bool fill) {
+    // Run-length decoder. Control byte 0x00-0x7F: 1-128 literal bytes follow. Control byte
+    // 0x80-0xFF: the next byte is repeated 2-129 times. Returns the expanded data size, or
+    // 0xFF (odd, invalid) if the data is truncated or doesn't fit in a page. When "fill" is
+    // true, the expanded words are written to the temporary page buffer.
+    uint8_t data_len = 0;
+    uint8_t word_lsb = 0;
+    uint8_t i = 0;
+    while (i < z_len) {
+        uint8_t control = z_data[i++];
+        bool repeat = (control & 0x80);
+        uint8_t count = (repeat ? ((control & 0x7F) + 2) : (control + 1));
+        if ((uint16_t)(data_len + count) > SPM_PAGESIZE) {
+            return 0xFF;
+        }
+        while (count-- > 0) {
+            if (i >= z_len) {
+                return 0xFF;
+            }
+            uint8_t data_byte = z_data[i];
+            if (!repeat) {
+                i++;
+            }
+            if (fill) {
+                if (data_len & 0x01) {
+                    uint8_t word_ix = (p_mem_pack->page_ix + data_len - 1);
+                    uint16_t page_word = ((data_byte << 8) | word_lsb);
+                    if ((p_mem_pack->page_addr + word_ix) == RESET_PAGE) {
+#if AUTO_PAGE_ADDR
+                        p_mem_pack->app_reset_lsb = word_lsb;
+                        p_mem_pack->app_reset_msb = data_byte;
+#endif  // AUTO_PAGE_ADDR
+                        // Modify the reset vector to point to this bootloader (see Reply_WRITPAGE)
+                        page_word = (0xC000 + ((TIMONEL_START / 2) - 1));
+                    }
+                    boot_page_fill((p_mem_pack->page_addr + word_ix), page_word);
+                } else {
+                    word_lsb = data_byte;
+                }
+            }
+            data_len++;
+        }
+        if (repeat) {
+            i++;
+        }
+    }
+    return data_len;
+}
+#endif  // CMD_WRITPAGZ
+
 #if CMD_READFLASH
 /* ____________________
   |                    |
@@ -549,20 +1266,36 @@ inline void Reply_WRITPAGE(const uint8_t *command, MemPack *p_mem_pack) {
   |____________________|
 */
 inline void Reply_READFLSH(const uint8_t *command) {
-    const uint8_t reply_len = (command[3] + 2);  // Reply length: ack + memory positions requested + checksum
+    if (command[3] > SLV_PACKET_SIZE) {
+        UsiTwiTransmitByte(UNKNOWNC);  // The reply would overflow the TX buffer, sized for SLV_PACKET_SIZE
+        return;
+    }
+    const uint8_t reply_len = (command[3] + 1 + CHECKSUM_SIZE);  // Reply length: ack + memory positions requested + checksum
     uint8_t reply[reply_len];
     reply[0] = ACKRDFSH;
-    reply[reply_len - 1] = 0;  // Checksum initialization
     // Point the initial memory position to the received address, then
     // advance to fill the reply with the requested data amount.
     const __flash uint8_t *mem_position;
     mem_position = (void *)((command[1] << 8) + command[2]);
+#if USE_CRC16
+    uint16_t crc = 0x0000;
+    crc = _crc_xmodem_update(crc, command[1]);  // Add received address MSB to CRC
+    crc = _crc_xmodem_update(crc, command[2]);  // Add received address LSB to CRC
+    for (uint8_t i = 1; i < command[3] + 1; i++) {
+        reply[i] = (*(mem_position++) & 0xFF);    // Actual memory position data
+        crc = _crc_xmodem_update(crc, reply[i]);  // CRC-16 accumulator
+    }
+    reply[reply_len - 2] = (uint8_t)(crc >> 8);
+    reply[reply_len - 1] = (uint8_t)(crc & 0xFF);
+#else
+    reply[reply_len - 1] = 0;  // Checksum initialization
     for (uint8_t i = 1; i < command[3] + 1; i++) {
         reply[i] = (*(mem_position++) & 0xFF);        // Actual memory position data
         reply[reply_len - 1] += (uint8_t)(reply[i]);  // Checksum accumulator
     }
     reply[reply_len - 1] += (uint8_t)(command[1]);  // Add Received address MSB to checksum
     reply[reply_len - 1] += (uint8_t)(command[2]);  // Add Received address MSB to checksum
+#endif  // USE_CRC16
     for (uint8_t i = 0; i < reply_len; i++) {
         UsiTwiTransmitByte(reply[i]);
     }
@@ -642,6 +1375,493 @@ inline void Reply_READEEPR(const uint8_t *command) {
 }
 #endif  // EEPROM_ACCESS
 
+#if CMD_GETPGCRC
+/* ____________________
+  |                    |
+  |   Reply_GETPGCRC   |
+  |____________________|
+*/
+inline void Reply_GETPGCRC(const uint8_t *command) {
+    uint16_t page_addr = ((command[1] << 8) + command[2]);  // Sets the first flash memory page address
+    page_addr &= ~(SPM_PAGESIZE - 1);                       // Keep only pages' base addresses
+    uint8_t page_count = command[3];                        // Amount of pages requested
+    if (page_count > GETPGCRC_MAXPG) {
+        page_count = GETPGCRC_MAXPG;  // Limit the reply to the slave-to-master packet size
+    }
+    UsiTwiTransmitByte(ACKPGCRC);
+    UsiTwiTransmitByte(page_count);  // Returns the amount of page CRCs that will follow
+    while (page_count-- > 0) {
+        uint16_t crc = CalculateCrc(page_addr, SPM_PAGESIZE);
+        UsiTwiTransmitByte((uint8_t)(crc >> 8));    // Page CRC MSB
+        UsiTwiTransmitByte((uint8_t)(crc & 0xFF));  // Page CRC LSB
+        page_addr += SPM_PAGESIZE;
+    }
+}
+
+/* ____________________
+  |                    |
+  |    CalculateCrc    |
+  |____________________|
+*/
+uint16_t CalculateCrc(uint16_t mem_addr, uint16_t length) {
+    // CRC-16/XMODEM (polynomial 0x1021, initial value 0x0000) of a flash memory block
+    const __flash uint8_t *mem_position;
+    mem_position = (void *)mem_addr;
+    uint16_t crc = 0x0000;
+    while (length-- > 0) {
+        crc = _crc_xmodem_update(crc, *(mem_position++));
+    }
+    return crc;
+}
+#endif  // CMD_GETPGCRC
+
+#if CMD_GETWSTAT
+/* ____________________
+  |                    |
+  |   Reply_GETWSTAT   |
+  |____________________|
+*/
+inline void Reply_GETWSTAT(MemPack *p_mem_pack) {
+    uint8_t reply[GETWSTAT_RPLYLN];
+    reply[0] = ACKWSTAT;
+    reply[1] = (uint8_t)(p_mem_pack->page_addr >> 8);    // Page address MSB
+    reply[2] = (uint8_t)(p_mem_pack->page_addr & 0xFF);  // Page address LSB
+    reply[3] = p_mem_pack->page_ix;                      // Page index where the next packet will be written
+    reply[4] = p_mem_pack->flags;                        // Flags byte, bit 5 set: the last packet was rejected
+    for (uint8_t i = 0; i < GETWSTAT_RPLYLN; i++) {
+        UsiTwiTransmitByte(reply[i]);
+    }
+}
+#endif  // CMD_GETWSTAT
+
+#if CMD_READSTRM
+/* ____________________
+  |                    |
+  |   Reply_READSTRM   |
+  |____________________|
+*/
+inline void Reply_READSTRM(const uint8_t *command, MemPack *p_mem_pack) {
+    // Command: READSTRM, start address MSB, start address LSB, length MSB, length LSB.
+    // Only the acknowledge goes into the TX buffer, the data bytes and the CRC-16 are
+    // read by "ReadStreamByte" when the TX buffer runs empty while sending.
+    uint16_t mem_addr = ((command[1] << 8) + command[2]);
+    uint16_t length = ((command[3] << 8) + command[4]);
+    // Cut the range at the flash memory end, so the byte count plus the CRC can't wrap around
+    uint16_t length_max = ((mem_addr <= FLASHEND) ? (FLASHEND - mem_addr + 1) : 0);
+    if (length > length_max) {
+        length = length_max;
+    }
+    p_mem_pack->rd_stm_position = (void *)mem_addr;
+    p_mem_pack->rd_stm_len = (length + READSTRM_CRCLN);
+    p_mem_pack->rd_stm_crc = 0x0000;
+    UsiTwiTransmitByte(ACKRDSTM);
+#if ENABLE_LED_UI
+    LED_UI_PORT ^= (1 << LED_UI_PIN);  // Blinks whenever a memory stream is started
+#endif                                 // ENABLE_LED_UI
+}
+
+/* ____________________
+  |                    |
+  |   ReadStreamByte   |
+  |____________________|
+*/
+inline uint8_t ReadStreamByte(MemPack *p_mem_pack) {
+    uint8_t data_byte;
+    if (p_mem_pack->rd_stm_len > READSTRM_CRCLN) {
+        data_byte = *(p_mem_pack->rd_stm_position++);                                    // Actual memory position data
+        p_mem_pack->rd_stm_crc = _crc_xmodem_update(p_mem_pack->rd_stm_crc, data_byte);  // Stream CRC-16 accumulator
+    } else if (p_mem_pack->rd_stm_len == READSTRM_CRCLN) {
+        data_byte = (uint8_t)(p_mem_pack->rd_stm_crc >> 8);  // Stream CRC-16 MSB
+    } else {
+        data_byte = (uint8_t)(p_mem_pack->rd_stm_crc & 0xFF);  // Stream CRC-16 LSB
+    }
+    p_mem_pack->rd_stm_len--;
+    return data_byte;
+}
+#endif  // CMD_READSTRM
+
+#if CMD_GETIMCRC
+/* ____________________
+  |                    |
+  |   Reply_GETIMCRC   |
+  |____________________|
+*/
+inline void Reply_GETIMCRC(const uint8_t *command, MemPack *p_mem_pack) {
+    // Command: GETIMCRC, start address MSB, start address LSB, length MSB, length LSB (0: up to TIMONEL_START)
+    // Reply: ACKIMCRC, status (IMCRC_READY, IMCRC_BUSY or IMCRC_BADRNG), CRC MSB, CRC LSB
+    uint16_t mem_addr = ((command[1] << 8) + command[2]);
+    uint16_t length = ((command[3] << 8) + command[4]);
+    uint16_t length_max = ((mem_addr < TIMONEL_START) ? (TIMONEL_START - mem_addr) : 0);
+    uint8_t status = IMCRC_BUSY;
+    if (length == 0) {
+        length = length_max;
+    }
+    if ((length == 0) || (length > length_max)) {
+        status = IMCRC_BADRNG;  // The range starts or ends beyond the application area
+        p_mem_pack->crc_len = 0;
+        p_mem_pack->crc_value = 0x0000;
+    } else if ((mem_addr != p_mem_pack->crc_addr) || (length != p_mem_pack->crc_len)) {
+        // New range: start calculating it in the main loop, the master asks again for the result
+        p_mem_pack->crc_addr = mem_addr;
+        p_mem_pack->crc_len = length;
+        p_mem_pack->crc_ix = 0;
+        p_mem_pack->crc_value = 0x0000;
+    } else if (p_mem_pack->crc_ix == p_mem_pack->crc_len) {
+        status = IMCRC_READY;
+        p_mem_pack->crc_len = 0;  // Result delivered, the next request calculates it again
+    }
+    UsiTwiTransmitByte(ACKIMCRC);
+    UsiTwiTransmitByte(status);
+    UsiTwiTransmitByte((uint8_t)(p_mem_pack->crc_value >> 8));    // Image CRC MSB
+    UsiTwiTransmitByte((uint8_t)(p_mem_pack->crc_value & 0xFF));  // Image CRC LSB
+}
+
+/* ____________________
+  |                    |
+  |    ImageCrcStep    |
+  |____________________|
+*/
+inline void ImageCrcStep(MemPack *p_mem_pack) {
+    // Rebuild the application reset vector from the trampoline (see the trampoline calculation in main)
+    const __flash uint8_t *mem_position;
+    mem_position = (void *)(TIMONEL_START - 2);
+    uint16_t app_reset = (*mem_position & 0xFF);
+    app_reset += ((*(++mem_position) & 0xFF) << 8);
+    bool app_present = (app_reset != 0xFFFF);  // No trampoline: there is no application to restore
+    app_reset = (((app_reset + (TIMONEL_START >> 1) - 1) & 0x0FFF) | 0xC000);
+    // CRC-16/XMODEM of the range, with the reset vector written by the master
+    // and the trampoline bytes as blank, so it matches the application file.
+    uint16_t mem_addr = (p_mem_pack->crc_addr + p_mem_pack->crc_ix);
+    uint16_t crc = p_mem_pack->crc_value;
+    mem_position = (void *)mem_addr;
+    for (uint8_t i = 0; (i < IMCRC_STEP_SIZE) && (p_mem_pack->crc_ix < p_mem_pack->crc_len); i++) {
+        uint8_t data_byte = *(mem_position++);
+        if (app_present) {
+            if (mem_addr == RESET_PAGE) {
+                data_byte = (uint8_t)(app_reset & 0xFF);  // Application reset vector LSB
+            } else if (mem_addr == (RESET_PAGE + 1)) {
+                data_byte = (uint8_t)(app_reset >> 8);  // Application reset vector MSB
+            } else if ((mem_addr >= (TIMONEL_START - 2)) && (mem_addr < TIMONEL_START)) {
+                data_byte = 0xFF;  // Trampoline bytes as blank
+            }
+        }
+        crc = _crc_xmodem_update(crc, data_byte);
+        mem_addr++;
+        p_mem_pack->crc_ix++;
+    }
+    p_mem_pack->crc_value = crc;
+}
+#endif  // CMD_GETIMCRC
+
+#if CMD_DELPAGES
+/* ____________________
+  |                    |
+  |   Reply_DELPAGES   |
+  |____________________|
+*/
+inline void Reply_DELPAGES(const uint8_t *command, MemPack *p_mem_pack) {
+    // Command: DELPAGES, first page address MSB, first page address LSB, page count
+    uint16_t page_addr = ((command[1] << 8) + command[2]);  // Sets the first flash memory page address
+    page_addr &= ~(SPM_PAGESIZE - 1);                       // Keep only pages' base addresses
+    uint8_t page_count = 0;
+    if (page_addr < APP_LIMIT) {
+        page_count = command[3];
+        if (page_count > ((APP_LIMIT - page_addr) / SPM_PAGESIZE)) {
+            page_count = ((APP_LIMIT - page_addr) / SPM_PAGESIZE);  // Never erase the bootloader
+        }
+    }
+    p_mem_pack->del_page_addr = page_addr;
+    p_mem_pack->del_page_count = page_count;  // The pages are erased when the reply is complete
+    UsiTwiTransmitByte(ACKDELPG);
+    UsiTwiTransmitByte(page_count);  // Returns the amount of pages that will be erased
+}
+#endif  // CMD_DELPAGES
+
+#if EEPROM_BLOCKS
+/* ____________________
+  |                    |
+  |   Reply_WRITEEPB   |
+  |____________________|
+*/
+inline void Reply_WRITEEPB(const uint8_t *command, MemPack *p_mem_pack) {
+    // Command: WRITEEPB, EEPROM address MSB, EEPROM address LSB, length, data bytes, checksum
+    uint8_t reply[WRITEEPB_RPLYLN] = {0};
+    uint8_t data_len = command[3];
+    if (data_len > WRITEEPB_MAXLN) {
+        data_len = WRITEEPB_MAXLN;  // Never read past the command buffer
+    }
+    reply[0] = ACKWTEPB;
+    // The checksum covers the address, the length and the data bytes
+#if USE_CRC16
+    uint16_t crc = 0x0000;
+    for (uint8_t i = 1; i < (data_len + 4); i++) {
+        crc = _crc_xmodem_update(crc, command[i]);  // Reply CRC-16 accumulator
+    }
+    reply[2] = (uint8_t)(crc >> 8);
+    reply[3] = (uint8_t)(crc & 0xFF);
+    bool packet_ok = ((reply[2] == command[data_len + 4]) && (reply[3] == command[data_len + 5]));
+#else
+    for (uint8_t i = 1; i < (data_len + 4); i++) {
+        reply[2] += (uint8_t)(command[i]);  // Reply checksum accumulator
+    }
+    bool packet_ok = (reply[2] == command[data_len + 4]);
+#endif  // USE_CRC16
+    if (packet_ok) {
+        uint16_t eeprom_addr = ((command[1] << 8) + command[2]);  // Set the first EEPROM address
+        for (uint8_t i = 0; i < data_len; i++) {
+            if (eeprom_read_byte((uint8_t *)((eeprom_addr + i) & E2END)) != command[i + 4]) {
+                reply[1]++;  // Bytes that will be written, the ones that already hold the value are skipped
+            }
+        }
+        // The bytes are written when the reply is complete, they stay in the command buffer meanwhile
+        p_mem_pack->eep_data = &command[4];
+        p_mem_pack->eep_addr = eeprom_addr;
+        p_mem_pack->eep_len = data_len;
+    }
+#if CMD_READSTAT
+    else {
+        run_stats.rejected++;
+    }
+#endif  // CMD_READSTAT
+    for (uint8_t i = 0; i < WRITEEPB_RPLYLN; i++) {
+        UsiTwiTransmitByte(reply[i]);
+    }
+}
+
+/* ____________________
+  |                    |
+  |   Reply_READEEPB   |
+  |____________________|
+*/
+inline void Reply_READEEPB(const uint8_t *command) {
+    // Command: READEEPB, EEPROM address MSB, EEPROM address LSB, length
+    uint8_t data_len = command[3];
+    if (data_len > READEEPB_MAXLN) {
+        data_len = READEEPB_MAXLN;  // Keep the whole reply in the TX buffer
+    }
+    uint16_t eeprom_addr = ((command[1] << 8) + command[2]);  // Set the first EEPROM address
+    UsiTwiTransmitByte(ACKRDEPB);
+    // The checksum covers the address and the data bytes, as in READFLSH
+#if USE_CRC16
+    uint16_t crc = 0x0000;
+    crc = _crc_xmodem_update(crc, command[1]);  // Add received address MSB to CRC
+    crc = _crc_xmodem_update(crc, command[2]);  // Add received address LSB to CRC
+#else
+    uint8_t checksum = (uint8_t)(command[1] + command[2]);
+#endif  // USE_CRC16
+    for (uint8_t i = 0; i < data_len; i++) {
+        uint8_t data_byte = eeprom_read_byte((uint8_t *)((eeprom_addr + i) & E2END));
+#if USE_CRC16
+        crc = _crc_xmodem_update(crc, data_byte);  // CRC-16 accumulator
+#else
+        checksum += data_byte;  // Checksum accumulator
+#endif  // USE_CRC16
+        UsiTwiTransmitByte(data_byte);
+    }
+#if USE_CRC16
+    UsiTwiTransmitByte((uint8_t)(crc >> 8));
+    UsiTwiTransmitByte((uint8_t)(crc & 0xFF));
+#else
+    UsiTwiTransmitByte(checksum);
+#endif  // USE_CRC16
+}
+#endif  // EEPROM_BLOCKS
+
+#if APP_AB_SLOTS
+/* ____________________
+  |                    |
+  |   Reply_SWITSLOT   |
+  |____________________|
+*/
+inline void Reply_SWITSLOT(const uint8_t *command, MemPack *p_mem_pack) {
+    // Command: SWITSLOT, slot (0: A, 1: B)
+    uint8_t slot = 0xFF;
+    if ((command[1] <= 1) && (FlashWord((command[1] == 1) ? SLOT_B_START : SLOT_A_START) != 0xFFFF)) {
+        slot = command[1];  // The slot holds an application, it's switched to when the reply is complete
+        p_mem_pack->flags &= ~(1 << FL_SLOT_B);
+        p_mem_pack->flags |= ((slot << FL_SLOT_B) | (1 << FL_SWITCH_SLOT));
+    }
+    UsiTwiTransmitByte(ACKSWSLT);
+    UsiTwiTransmitByte(slot);  // Returns the slot that will be active, 0xFF if it's empty
+}
+
+/* ____________________
+  |                    |
+  |     FlashWord      |
+  |____________________|
+*/
+inline uint16_t FlashWord(const uint16_t addr) {
+    const __flash uint8_t *mem_position;
+    mem_position = (void *)addr;
+    uint16_t data_word = (*mem_position & 0xFF);
+    data_word += ((*(++mem_position) & 0xFF) << 8);
+    return data_word;
+}
+
+/* ____________________
+  |                    |
+  |    InactiveSlot    |
+  |____________________|
+*/
+inline uint16_t InactiveSlot(void) {
+    // The trampoline jumps to the active slot reset vector. Without an application, the inactive slot is A.
+    return ((FlashWord(TIMONEL_START - 2) == RJMP((TIMONEL_START - 2), SLOT_A_START)) ? SLOT_B_START : SLOT_A_START);
+}
+#endif  // APP_AB_SLOTS
+
+#if CMD_READSTAT
+/* ____________________
+  |                    |
+  |   Reply_READSTAT   |
+  |____________________|
+*/
+inline void Reply_READSTAT(const uint8_t *command) {
+    // Command: READSTAT, clear (1: clear the counters after reading them)
+    uint8_t reply[READSTAT_RPLYLN];
+    reply[0] = ACKRDSTA;
+    reply[1] = TML_FEATURES;          // Optional features, as in GETTMNLV
+    reply[2] = TML_EXT_FEATURES;      // Extended optional features, as in GETTMNLV
+    reply[3] = OSCCAL;                // Internal RC oscillator calibration, as in GETTMNLV
+    reply[4] = run_stats.reset_flags;  // MCUSR reset flags of the last restart
+    // The counters follow, MSB first
+    reply[5] = (uint8_t)(run_stats.restarts >> 8);
+    reply[6] = (uint8_t)(run_stats.restarts & 0xFF);
+    reply[7] = (uint8_t)(run_stats.rejected >> 8);
+    reply[8] = (uint8_t)(run_stats.rejected & 0xFF);
+    reply[9] = (uint8_t)(run_stats.del_flash >> 8);
+    reply[10] = (uint8_t)(run_stats.del_flash & 0xFF);
+    reply[11] = (uint8_t)(run_stats.broadcasts >> 8);
+    reply[12] = (uint8_t)(run_stats.broadcasts & 0xFF);
+    reply[13] = (uint8_t)(run_stats.pages >> 8);
+    reply[14] = (uint8_t)(run_stats.pages & 0xFF);
+    reply[15] = (uint8_t)(run_stats.slow_ticks >> 24);
+    reply[16] = (uint8_t)(run_stats.slow_ticks >> 16);
+    reply[17] = (uint8_t)(run_stats.slow_ticks >> 8);
+    reply[18] = (uint8_t)(run_stats.slow_ticks & 0xFF);
+    if (command[1] == 1) {
+        run_stats = (RunStats){.magic = STATS_MAGIC, .reset_flags = run_stats.reset_flags};
+    }
+    for (uint8_t i = 0; i < READSTAT_RPLYLN; i++) {
+        UsiTwiTransmitByte(reply[i]);
+    }
+}
+
+/* ____________________
+  |                    |
+  |   CountSlowTicks   |
+  |____________________|
+*/
+inline void CountSlowTicks(void) {
+    // Adds the timer 0 ticks since the slow-ops started or the last call, which must be less than 512
+    uint16_t ticks = TCNT0;
+    if ((TMR0_FLAG_REG >> TOV0) & true) {
+        ticks += 0x100;  // The 8-bit timer overflowed once
+    }
+    TCNT0 = 0;
+    TMR0_FLAG_REG = (1 << TOV0);
+    run_stats.slow_ticks += ticks;
+}
+#endif  // CMD_READSTAT
+
+#if CMD_OSCTUNE
+/* ____________________
+  |                    |
+  |   Reply_TUNEOSCC   |
+  |____________________|
+*/
+inline void Reply_TUNEOSCC(const uint8_t *command, MemPack *p_mem_pack) {
+    // Command: TUNEOSCC, OSCCAL setting. A new setting starts a trial, applied after this reply,
+    // and sending the same setting again confirms it. Settings in the other frequency range are
+    // ignored, since the frequency isn't monotonic across the range bit.
+    uint8_t osccal = command[1];
+    bool allowed = !(((osccal ^ p_mem_pack->osc_safe) >> OSC_RANGE_BIT) & true);
+#if AUTO_CLK_TWEAK
+    if ((boot_lock_fuse_bits_get(GET_LOW_FUSE_BITS) & 0x0F) != RCOSC_CLK_SRC) {
+        allowed = false;  // The oscillator calibration only applies to the RC oscillator clock source
+    }
+#endif  // AUTO_CLK_TWEAK
+    if (allowed) {
+        if (osccal == p_mem_pack->osc_target) {
+            p_mem_pack->osc_safe = osccal;  // Confirmed: it carried this command and the previous reply
+            p_mem_pack->osc_trial = 0;
+        } else {
+            p_mem_pack->osc_target = osccal;
+            p_mem_pack->osc_trial = OSC_TRIAL_TICKS;
+            WDT_CTRL_REG = ((1 << WDIF) | (1 << WDIE));  // Watchdog interrupt mode, 16 ms ticks polled to time the trial
+        }
+    }
+    uint8_t reply[TUNEOSCC_RPLYLN];
+    reply[0] = ACKTNOSC;
+    reply[1] = p_mem_pack->osc_target;  // Setting being tried, or the confirmed one
+    reply[2] = p_mem_pack->osc_safe;    // Last confirmed setting
+    reply[3] = 0x55;                    // Test pattern, alternating and all-ones bits
+    reply[4] = 0xAA;
+    reply[5] = 0x00;
+    reply[6] = 0xFF;
+    reply[7] = 0;
+    for (uint8_t i = 1; i < (TUNEOSCC_RPLYLN - 1); i++) {
+        reply[7] += reply[i];  // 8-bit additive checksum of the settings and the pattern
+    }
+    for (uint8_t i = 0; i < TUNEOSCC_RPLYLN; i++) {
+        UsiTwiTransmitByte(reply[i]);
+    }
+}
+
+/* ____________________
+  |                    |
+  |   StepOscillator   |
+  |____________________|
+*/
+inline void StepOscillator(const uint8_t osccal) {
+    // Changes OSCCAL one step at a time, big frequency jumps can upset the CPU
+    while (OSCCAL != osccal) {
+        if (OSCCAL < osccal) {
+            OSCCAL++;
+        } else {
+            OSCCAL--;
+        }
+    }
+}
+#endif  // CMD_OSCTUNE
+
+#if STREAM_PAGE_FILL
+/* ____________________
+  |                    |
+  |   StreamPageFill   |
+  |____________________|
+*/
+inline void StreamPageFill(const uint8_t data_byte, MemPack *p_mem_pack) {
+#if USE_CRC16
+    p_mem_pack->stream_chk = _crc_xmodem_update(p_mem_pack->stream_chk, data_byte);  // Packet CRC-16 accumulator
+#else
+    p_mem_pack->stream_chk += data_byte;  // Packet checksum accumulator
+#endif  // USE_CRC16
+    if (p_mem_pack->stream_ix & 0x01) {
+        p_mem_pack->stream_lsb = data_byte;  // Odd data bytes are the page words LSB ...
+    } else {
+        // ... and even data bytes complete them, so each word is written to the temporary page buffer.
+        uint8_t word_ix = (p_mem_pack->page_ix + p_mem_pack->stream_ix - 2);
+        uint16_t page_word = ((data_byte << 8) | p_mem_pack->stream_lsb);
+        if ((p_mem_pack->page_addr + word_ix) == RESET_PAGE) {
+#if AUTO_PAGE_ADDR
+            p_mem_pack->app_reset_lsb = p_mem_pack->stream_lsb;
+            p_mem_pack->app_reset_msb = data_byte;
+#endif  // AUTO_PAGE_ADDR
+            // Modify the reset vector to point to this bootloader (see Reply_WRITPAGE)
+            page_word = (0xC000 + ((TIMONEL_START / 2) - 1));
+        }
+#if CHECK_PAGE_IX
+        if (word_ix < SPM_PAGESIZE) {
+            boot_page_fill((p_mem_pack->page_addr + word_ix), page_word);
+        }
+#else
+        boot_page_fill((p_mem_pack->page_addr + word_ix), page_word);
+#endif  // CHECK_PAGE_IX
+    }
+    p_mem_pack->stream_ix++;
+}
+#endif  // STREAM_PAGE_FILL
+
 /* ____________________
   |                    |
   |   ResetPrescaler   |
@@ -739,19 +1959,17 @@ inline bool UsiOverflowHandler(MemPack *p_mem_pack) {
                 if (USIDR & 0x01) {  // If data register low-order bit = 1, start the send data mode
                     // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
                     // Address bit 0 is = 1, processing the received command & sending data   >>
-                    uint8_t command_size = rx_byte_count;                //                    >>
-                    static uint8_t command[MST_PACKET_SIZE * 2];         //  Read the receive   >>
-                    for (uint8_t i = 0; i < command_size; i++) {         //  buffer, then call   >>
-                        rx_tail = ((rx_tail + 1) & TWI_RX_BUFFER_MASK);  //  "ReceiveEvent" to    >>
-                        rx_byte_count--;                                 //  process the received >>
-                        command[i] = rx_buffer[rx_tail];                 //  command and send    >>
-                    }                                                    //  the reply.         >>
-                    ReceiveEvent(command, p_mem_pack);                   //                    >>
+                    ProcessCommand(p_mem_pack);  //                                            >>
                     //                                                                        >>
                     // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
                     // Next state -> STATE_SEND_DATA_BYTE
                     device_state = STATE_SEND_DATA_BYTE;
                 } else {  // If data register low-order bit = 0, start the receive data mode
+#if TWI_BROADCAST
+                    if (USIDR == 0) {
+                        p_mem_pack->flags |= (1 << FL_BROADCAST);  // General call: run the command at the stop condition
+                    }
+#endif  // TWI_BROADCAST
                     // Next state -> STATE_RECEIVE_DATA_BYTE
                     device_state = STATE_RECEIVE_DATA_BYTE;
                 }
@@ -785,6 +2003,11 @@ inline bool UsiOverflowHandler(MemPack *p_mem_pack) {
                 // If the TX buffer has data, copy the next byte to USI data register for sending
                 tx_tail = ((tx_tail + 1) & TWI_TX_BUFFER_MASK);
                 USIDR = tx_buffer[tx_tail];
+#if CMD_READSTRM
+            } else if (p_mem_pack->rd_stm_len > 0) {
+                // If the TX buffer is empty while streaming, send the next flash memory byte
+                USIDR = ReadStreamByte(p_mem_pack);
+#endif  // CMD_READSTRM
             } else {
                 // If the TX buffer is empty ...
                 SET_USI_TO_RECEIVE_ACK();  // This might be necessary (http://www.avrfreaks.net/index.php?name=PNphpBB2&file=viewtopic&p=805227#805227)
@@ -818,10 +2041,32 @@ inline bool UsiOverflowHandler(MemPack *p_mem_pack) {
         // counter overflows, return to the previous state (STATE_RECEIVE_DATA_BYTE).
         // This mode's cycle should end when a stop condition is detected on the bus.
         case STATE_PUT_BYTE_IN_RX_BUFFER_AND_SEND_ACK: {
-            // Put data into buffer
-            rx_head = ((rx_head + 1) & TWI_RX_BUFFER_MASK);
-            rx_buffer[rx_head] = USIDR;
-            rx_byte_count++;            
+#if STREAM_PAGE_FILL
+            // WRITPAGE data bytes go straight to the temporary page buffer, only the
+            // command opcode and the packet checksum are put into the RX buffer.
+            if ((p_mem_pack->stream_ix > 0) && (p_mem_pack->stream_ix <= MST_PACKET_SIZE)) {
+                StreamPageFill(USIDR, p_mem_pack);
+                // Next state -> STATE_RECEIVE_DATA_BYTE
+                device_state = STATE_RECEIVE_DATA_BYTE;
+                SET_USI_TO_SEND_ACK();
+                return false;
+            }
+            if ((rx_byte_count == 0) && (USIDR == WRITPAGE)) {
+                p_mem_pack->stream_ix = 1;  // Start streaming the packet data
+                p_mem_pack->stream_chk = 0;
+#if TWI_BROADCAST
+                if (((p_mem_pack->flags >> FL_BROADCAST) & true) && (p_mem_pack->page_ix == 0)) {
+                    boot_temp_buff_erase();  // Start each general call page from a clean buffer
+                }
+#endif  // TWI_BROADCAST
+            }
+#endif  // STREAM_PAGE_FILL
+            // Put data into buffer, the bytes that exceed the buffer size are dropped
+            if (rx_byte_count < TWI_RX_BUFFER_SIZE) {
+                rx_head = ((rx_head + 1) & TWI_RX_BUFFER_MASK);
+                rx_buffer[rx_head] = USIDR;
+                rx_byte_count++;
+            }
             // Next state -> STATE_RECEIVE_DATA_BYTE
             device_state = STATE_RECEIVE_DATA_BYTE;
             SET_USI_TO_SEND_ACK();
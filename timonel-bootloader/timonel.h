@@ -18,7 +18,9 @@
 #ifndef TML_CONFIG_H
 #define TML_CONFIG_H
 
-#ifndef __AVR_ATtiny85__
+#if !(defined(__AVR_ATtiny25__) | defined(__AVR_ATtiny45__) | defined(__AVR_ATtiny85__) | \
+      defined(__AVR_ATtiny24__) | defined(__AVR_ATtiny44__) | defined(__AVR_ATtiny84__) | \
+      defined(__AVR_ATtiny87__))
 #define __AVR_ATtiny85__
 #pragma message "   >>>   Run, Timonel, run!   <<<   "
 #endif
@@ -30,18 +32,116 @@
 #include <avr/wdt.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <util/crc16.h>
 
+#ifdef PLATFORMIO
+#include <nb-twi-cmd.h>  // PlatformIO builds get it from the "nb-twi-cmd" library dependency
+#else
 #include "../../../nb-twi-cmd/src/nb-twi-cmd.h"
+#endif  // PLATFORMIO
+
+// Timonel commands not included in "nb-twi-cmd.h"
+#ifndef GETPGCRC
+#define GETPGCRC 0x8B /* Get the CRC-16 of one or more flash memory pages */
+#define ACKPGCRC 0x74 /* GETPGCRC command acknowledge */
+#endif                /* GETPGCRC */
+#ifndef NAKWTPAG
+#define NAKWTPAG 0xFA /* WRITPAGE packet rejected by checksum, the master should resend it */
+#endif                /* NAKWTPAG */
+#ifndef NAKPGRST
+#define NAKPGRST 0xF9 /* WRITPAGE packet rejected and page buffer cleared, the master should resend the whole page */
+#endif                /* NAKPGRST */
+#ifndef GETWSTAT
+#define GETWSTAT 0x8C /* Get the page write status: page address and index expected next */
+#define ACKWSTAT 0x73 /* GETWSTAT command acknowledge */
+#endif                /* GETWSTAT */
+#ifndef WRITPAGZ
+#define WRITPAGZ 0x8D /* Write a run-length compressed data packet into the flash page buffer */
+#define ACKWTPGZ 0x72 /* WRITPAGZ command acknowledge */
+#endif                /* WRITPAGZ */
+#ifndef READSTRM
+#define READSTRM 0x8E /* Read a flash memory range of any length as one stream, ending with its CRC-16 */
+#define ACKRDSTM 0x71 /* READSTRM command acknowledge */
+#endif                /* READSTRM */
+#ifndef GETIMCRC
+#define GETIMCRC 0x8F /* Get the CRC-16 of the application image, as it was sent by the master */
+#define ACKIMCRC 0x70 /* GETIMCRC command acknowledge */
+#endif                /* GETIMCRC */
+#ifndef DELPAGES
+#define DELPAGES 0x90 /* Delete a range of application flash memory pages, without restarting */
+#define ACKDELPG 0x6F /* DELPAGES command acknowledge */
+#endif                /* DELPAGES */
+#ifndef WRITEEPB
+#define WRITEEPB 0x91 /* Write a block of EEPROM bytes, skipping the ones that already hold the value */
+#define ACKWTEPB 0x6E /* WRITEEPB command acknowledge */
+#endif                /* WRITEEPB */
+#ifndef READEEPB
+#define READEEPB 0x92 /* Read a block of EEPROM bytes */
+#define ACKRDEPB 0x6D /* READEEPB command acknowledge */
+#endif                /* READEEPB */
+#ifndef SWITSLOT
+#define SWITSLOT 0x93 /* Switch the active application slot (A/B slots) */
+#define ACKSWSLT 0x6C /* SWITSLOT command acknowledge */
+#endif                /* SWITSLOT */
+#ifndef READSTAT
+#define READSTAT 0x94 /* Read the runtime statistics counters */
+#define ACKRDSTA 0x6B /* READSTAT command acknowledge */
+#endif                /* READSTAT */
+#ifndef STPGBRST
+#define STPGBRST 0x95 /* Set the first page address and page count of a multi-page WRITPAGE burst */
+#define AKPGBRST 0x6A /* STPGBRST command acknowledge */
+#endif                /* STPGBRST */
+#ifndef TUNEOSCC
+#define TUNEOSCC 0x96 /* Try or confirm an internal RC oscillator calibration (OSCCAL) setting */
+#define ACKTNOSC 0x69 /* TUNEOSCC command acknowledge */
+#endif                /* TUNEOSCC */
 
 // Memory management and flags data pack
 typedef struct m_pack {
     uint16_t page_addr;  // Flash memory page address
-    uint8_t page_ix;     // Flash memory page index
-    uint8_t flags;       // Bit: 8, 7, 6, 5: not used; 4: exit; 3: delete app; 2, 1: initialized
+    uint8_t page_ix;     // Flash memory page index (0 to SPM_PAGESIZE, up to 128 bytes)
+    uint8_t flags;       // Bit: 8: slot B; 7: switch slot; 6: general call; 5: packet rejected; 4: exit; 3: delete app; 2, 1: initialized
 #if AUTO_PAGE_ADDR
     uint8_t app_reset_lsb;  // Application first byte: reset vector LSB
     uint8_t app_reset_msb;  // Application second byte: reset vector MSB
 #endif                      // AUTO_PAGE_ADDR
+#if STREAM_PAGE_FILL
+    uint8_t stream_ix;    // WRITPAGE data bytes streamed so far + 1 (0: not streaming)
+    uint8_t stream_lsb;   // Last odd data byte streamed: page word LSB
+#if USE_CRC16
+    uint16_t stream_chk;  // Streamed packet CRC-16 accumulator
+#else
+    uint8_t stream_chk;   // Streamed packet checksum accumulator
+#endif                    // USE_CRC16
+#endif                    // STREAM_PAGE_FILL
+#if CMD_READSTRM
+    const __flash uint8_t *rd_stm_position;  // READSTRM next flash memory position to send
+    uint16_t rd_stm_len;                     // READSTRM data bytes left to send + 2 CRC bytes (0: not streaming)
+    uint16_t rd_stm_crc;                     // READSTRM stream CRC-16 accumulator
+#endif                                       // CMD_READSTRM
+#if CMD_DELPAGES
+    uint16_t del_page_addr;  // DELPAGES first flash memory page to erase
+    uint8_t del_page_count;  // DELPAGES pages left to erase (0: none)
+#endif                       // CMD_DELPAGES
+#if CMD_PGBURST
+    uint8_t burst_count;  // STPGBRST pages left to write, advancing the page address after each one (0: none)
+#endif                    // CMD_PGBURST
+#if CMD_OSCTUNE
+    uint8_t osc_target;   // TUNEOSCC OSCCAL setting, reached in single steps after the reply
+    uint8_t osc_safe;     // Last OSCCAL setting confirmed by the master
+    uint8_t osc_trial;    // Watchdog ticks left to confirm the target setting (0: confirmed)
+#endif                    // CMD_OSCTUNE
+#if CMD_GETIMCRC
+    uint16_t crc_addr;   // GETIMCRC range start address
+    uint16_t crc_len;    // GETIMCRC range length (0: no calculation requested)
+    uint16_t crc_ix;     // GETIMCRC range bytes already added to the CRC
+    uint16_t crc_value;  // GETIMCRC CRC-16 accumulator
+#endif                   // CMD_GETIMCRC
+#if EEPROM_BLOCKS
+    const uint8_t *eep_data;  // WRITEEPB data bytes, kept in the command buffer until they are written
+    uint16_t eep_addr;        // WRITEEPB first EEPROM address to write
+    uint8_t eep_len;          // WRITEEPB data bytes left to write (0: none)
+#endif                        // EEPROM_BLOCKS
 } MemPack;                  // "Memory pack" structure
 
 /* ====== [   The configuration of the next optional features can be checked   ] ====== */
@@ -104,8 +204,11 @@ typedef struct m_pack {
                              /* NOTE: This value can be set externally as a makefile option         */
 
 // Bit 1
-#define FORCE_ERASE_PG false /* If this option is enabled, each flash memory page is erased before  */
-                             /* writing new data. Normally, it shouldn't be necessary to enable it. */
+#ifndef FORCE_ERASE_PG       /* If this option is enabled, each flash memory page is erased right   */
+#define FORCE_ERASE_PG false /* before writing it, so the master can upload a new application with  */
+#endif /* FORCE_ERASE_PG */  /* no DELFLASH erase and restart first (erase-on-write). The master    */
+                             /* detects it with this GETTMNLV extended features bit.                */
+                             /* NOTE: This value can be set externally as a makefile option         */
 
 // Bit 2
 #define CLEAR_BIT_7_R31 false /* This is to avoid that the first bootloader instruction is skipped   */
@@ -127,7 +230,109 @@ typedef struct m_pack {
 #define EEPROM_ACCESS false /* reading and writing the device EEPROM.                              */
 #endif                      /* EEPROM_ACCESS */
 
+// Bit 6
+#ifndef CMD_GETPGCRC       /* This option enables the GETPGCRC command, which returns the CRC-16  */
+#define CMD_GETPGCRC false /* of one or more flash pages. It also makes Timonel erase each page  */
+#endif /* CMD_GETPGCRC */  /* right before writing it, so only the pages that differ from the    */
+                           /* new firmware have to be sent, without a previous DELFLASH.         */
+
+// Bit 7
+#ifndef USE_CRC16       /* If this option is enabled, WRITPAGE and READFLSH data packets are   */
+#define USE_CRC16 false /* checked with a CRC-16/XMODEM instead of an 8-bit additive checksum. */
+#endif /* USE_CRC16 */  /* A WRITPAGE packet with a wrong CRC is rejected (NAKWTPAG) without   */
+                        /* deleting the application, so the master can just resend it.        */
+
 /* ^^^^^^ [       End of feature settings shown in the GETTMNLV command.       ] ^^^^^^ */
+
+// Additional features (not shown in GETTMNLV)
+// ===========================================
+
+#ifndef CMD_GETWSTAT       /* This option enables the GETWSTAT command, which returns the page    */
+#define CMD_GETWSTAT false /* address and index where the next WRITPAGE packet will be written.   */
+#endif /* CMD_GETWSTAT */  /* It also makes WRITPAGE reject wrong packets (NAKWTPAG), keeping the */
+                           /* write position, instead of deleting the application. This allows  */
+                           /* the master to resume an upload by resending only the lost packet. */
+
+#ifndef STREAM_PAGE_FILL       /* If this option is enabled, the WRITPAGE data bytes are put straight */
+#define STREAM_PAGE_FILL false /* into the SPM temporary page buffer as they arrive, and the packet   */
+#endif /* STREAM_PAGE_FILL */  /* checksum is computed on the fly. The RX buffer only has to hold the */
+                               /* command opcode and checksum, saving RAM. A rejected packet clears  */
+                               /* the page buffer, so the master has to resend the whole page.       */
+
+#ifndef WRITPAGE_BUSY       /* If this option is enabled, the WRITPAGE reply carries an extra byte */
+#define WRITPAGE_BUSY false /* with the time in ms that the device will be busy programming flash  */
+#endif /* WRITPAGE_BUSY */  /* after the reply (0: not busy). This way, the master only waits when  */
+                            /* a page is completed, instead of after each packet.                  */
+
+#ifndef TWI_BROADCAST       /* If this option is enabled, the commands written to the TWI general  */
+#define TWI_BROADCAST false /* call address (0) are run when the master sends the stop condition,  */
+#endif /* TWI_BROADCAST */  /* without sending any reply. This allows flashing several devices at  */
+                            /* once, then polling each one at its own address to verify the pages. */
+
+#ifndef CMD_WRITPAGZ       /* This option enables the WRITPAGZ command, which works like WRITPAGE */
+#define CMD_WRITPAGZ false /* but carries run-length compressed data. Each packet is expanded     */
+#endif /* CMD_WRITPAGZ */  /* into the page buffer, so the blank and repeated byte runs take less */
+                           /* bus time. Packets are generated with "tml-hexparser --format rle". */
+
+#ifndef CMD_READSTRM       /* This option enables the READSTRM command: the master sets a flash   */
+#define CMD_READSTRM false /* start address and length once, then reads the whole range in one   */
+#endif /* CMD_READSTRM */  /* or more read transfers, fed from flash as the bytes are clocked out */
+                           /* and followed by the CRC-16/XMODEM of the range, for fast verifying. */
+
+#ifndef CMD_GETIMCRC       /* This option enables the GETIMCRC command, which returns the CRC-16  */
+#define CMD_GETIMCRC false /* of a flash range, by default [0, TIMONEL_START), calculated as the  */
+#endif /* CMD_GETIMCRC */  /* master sent the application: with its reset vector restored from   */
+                           /* the trampoline and the trampoline as blank, for single step verify. */
+
+#ifndef CMD_DELPAGES       /* This option enables the DELPAGES command, which erases a range of   */
+#define CMD_DELPAGES false /* application pages without restarting Timonel. The reset vector and */
+#endif /* CMD_DELPAGES */  /* the trampoline are kept, and the range can't reach the bootloader.  */
+                           /* Along with CMD_SETPGADDR, it allows updating application regions.  */
+
+#ifndef FAST_RESUME       /* If this option is enabled, a session token is kept in SRAM across  */
+#define FAST_RESUME false /* the DELFLASH restart, so Timonel comes back already initialized,   */
+#endif /* FAST_RESUME */  /* with no INITSOFT needed and no exit-to-app countdown. The token is  */
+                          /* ignored after a power-on or brown-out reset, and used only once.    */
+
+#ifndef TWI_FAST_POLL       /* If this option is enabled, while a TWI transfer is in progress the  */
+#define TWI_FAST_POLL false /* main loop only polls the USI flags, skipping the broadcast, slow-op */
+#endif /* TWI_FAST_POLL */  /* and led/exit countdown checks. This shortens the response time to  */
+                            /* each USI event, so the clock is stretched less at higher bus speeds. */
+
+#ifndef EEPROM_BLOCKS       /* This option enables the WRITEEPB and READEEPB commands, which write */
+#define EEPROM_BLOCKS false /* and read up to MST_PACKET_SIZE / SLV_PACKET_SIZE EEPROM bytes per   */
+#endif /* EEPROM_BLOCKS */  /* command, covered by one checksum. The bytes are written after the   */
+                            /* reply, skipping the ones that already hold the value to write.    */
+
+#ifndef FAST_APP_START       /* If this option is enabled, the application is started right after  */
+#define FAST_APP_START false /* reset, unless the STAY_PIN strap is tied to ground, the EEPROM byte */
+#endif /* FAST_APP_START */  /* at STAY_EEP_ADDR holds STAY_EEP_FLAG or there is no application. In */
+                             /* those cases, Timonel runs as usual, and EXITTMNL clears the flag.  */
+
+#ifndef APP_WARM_ENTRY       /* If this option is enabled, the application can enter Timonel by     */
+#define APP_WARM_ENTRY false /* jumping to TIMONEL_START with WARM_ENTRY_KEY in GPIOR0. Timonel     */
+#endif /* APP_WARM_ENTRY */  /* then comes up already initialized, with no INITSOFT needed and no   */
+                             /* exit-to-app countdown. Any reset clears GPIOR0, so it's ignored.    */
+
+#ifndef APP_AB_SLOTS         /* If this option is enabled, the application area is split in two     */
+#define APP_AB_SLOTS false   /* slots, A and B. The master only writes the inactive one, and then   */
+#endif /* APP_AB_SLOTS */    /* SWITSLOT commits it with a single trampoline page write. Page 0    */
+                             /* forwards the interrupt vectors to the slot through that page.      */
+
+#ifndef CMD_READSTAT         /* This option enables the READSTAT command, which returns counters of */
+#define CMD_READSTAT false   /* restarts, rejected packets, DELFLASH runs, general call commands,   */
+#endif /* CMD_READSTAT */    /* pages written and slow-op time. They are kept in ".noinit" SRAM, so */
+                             /* they survive the watchdog restarts, and cleared at power-on.       */
+
+#ifndef CMD_PGBURST          /* This option enables the STPGBRST command, which sets the address of */
+#define CMD_PGBURST false    /* the first page and a page count. The WRITPAGE packets that follow   */
+#endif /* CMD_PGBURST */     /* fill those pages one after the other, each one is written as it is  */
+                             /* completed, saving an STPGADDR command and its reply per page.       */
+
+#ifndef CMD_OSCTUNE          /* This option enables the TUNEOSCC command, which lets the master try */
+#define CMD_OSCTUNE false    /* faster or slower OSCCAL settings than the OSC_FAST one and keep the */
+#endif /* CMD_OSCTUNE */     /* fastest that runs error-free. A trial setting that the master does  */
+                             /* not confirm in time is reverted. Needs the 8 MHz RC oscillator.     */
 /* ====== [       ......................................................       ] ====== */
 
 /* ------------------------------------------------------------------------------------ */
@@ -137,8 +342,12 @@ typedef struct m_pack {
 /* ------------------------------------------------------------------------------------ */
 
 // TWI commands Xmit packet size
-#define MST_PACKET_SIZE 32 /* Master-to-slave Xmit packet size: always even values, min=2, max=32 */
-#define SLV_PACKET_SIZE 32 /* Slave-to-master Xmit packet size: always even values, min=2, max=32 */
+#ifndef MST_PACKET_SIZE       /* Master-to-slave Xmit packet size: always even values that divide   */
+#define MST_PACKET_SIZE 32    /* SPM_PAGESIZE, min=2, max=SPM_PAGESIZE. When it's set to the page   */
+#endif /* MST_PACKET_SIZE */  /* size, each WRITPAGE command carries a whole flash memory page.     */
+#ifndef SLV_PACKET_SIZE       /* Slave-to-master Xmit packet size: always even values, min=2,       */
+#define SLV_PACKET_SIZE 32    /* max=SPM_PAGESIZE.                                                  */
+#endif /* SLV_PACKET_SIZE */  /* NOTE: These values can be set externally as makefile options.      */
 
 // Led UI settings
 #ifndef LED_UI_PIN        /* GPIO pin to monitor activity. If ENABLE_LED_UI is enabled, some     */
@@ -149,6 +358,21 @@ typedef struct m_pack {
 #define LED_UI_DDR DDRB   /* Activity monitor led data register.                                 */
 #define LED_UI_PORT PORTB /* Activity monitor led port.                                          */
 
+// Boot policy settings
+#ifndef EXIT_TIMEOUT_MS      /* When APP_AUTORUN is enabled and this is not 0, the application is   */
+#define EXIT_TIMEOUT_MS 0    /* started after this many milliseconds without initialization, timed  */
+#endif /* EXIT_TIMEOUT_MS */ /* by the watchdog oscillator in 16 ms ticks, so it doesn't depend on  */
+                             /* the CPU clock. When it's 0, the main loop cycles are counted.       */
+#ifndef STAY_PIN             /* FAST_APP_START strap pin: when it reads low at reset (with its pull- */
+#define STAY_PIN PB3         /* up enabled), Timonel stays in the bootloader. -1 disables the strap. */
+#endif /* STAY_PIN */        /* NOTE: Avoid pins with loads to ground, e.g. a led.                   */
+#define STAY_PIN_PORT PORTB  /* Strap pin port.                                                      */
+#define STAY_PIN_PIN PINB    /* Strap pin input register.                                            */
+#ifndef STAY_EEP_ADDR        /* FAST_APP_START "stay in the bootloader" EEPROM flag address. When it */
+#define STAY_EEP_ADDR E2END  /* holds STAY_EEP_FLAG at reset, Timonel stays in the bootloader until  */
+#endif /* STAY_EEP_ADDR */   /* EXITTMNL, which erases the flag. -1 disables the flag.              */
+#define STAY_EEP_FLAG 0xB7   /* "Stay in the bootloader" EEPROM flag value.                         */
+
 // Timonel ID characters
 #define ID_CHAR_1 78  /* N */
 #define ID_CHAR_2 66  /* B */
@@ -160,21 +384,68 @@ typedef struct m_pack {
 #define FL_INIT_2 1    /* Flag bit 2 (2)  : Two-step initialization STEP 2 */
 #define FL_DEL_FLASH 2 /* Flag bit 3 (4)  : Delete flash memory            */
 #define FL_EXIT_TML 3  /* Flag bit 4 (8)  : Exit Timonel & run application */
-#define FL_BIT_5 4     /* Flag bit 5 (16) : Not used */
-#define FL_BIT_6 5     /* Flag bit 6 (32) : Not used */
-#define FL_BIT_7 6     /* Flag bit 7 (64) : Not used */
-#define FL_BIT_8 7     /* Flag bit 8 (128): Not used */
+#define FL_WRT_ERROR 4 /* Flag bit 5 (16) : Last WRITPAGE packet rejected */
+#define FL_BROADCAST 5 /* Flag bit 6 (32) : General call command being received */
+#define FL_SWITCH_SLOT 6 /* Flag bit 7 (64) : Switch the active application slot */
+#define FL_SLOT_B 7      /* Flag bit 8 (128): Slot to switch to is B */
+
+// Data packets checksum size
+#if USE_CRC16
+#define CHECKSUM_SIZE 2 /* CRC-16/XMODEM: MSB + LSB */
+#else
+#define CHECKSUM_SIZE 1 /* 8-bit additive checksum */
+#endif                  /* USE_CRC16 */
 
 // Length constants for command replies
 #define GETTMNLV_RPLYLN 12 /* GETTMNLV command reply length */
 #define STPGADDR_RPLYLN 2  /* STPGADDR command reply length */
-#define WRITPAGE_RPLYLN 2  /* WRITPAGE command reply length */
+#define STPGBRST_RPLYLN 2  /* STPGBRST command reply length */
+#if WRITPAGE_BUSY
+#define WRITPAGE_RPLYLN (2 + CHECKSUM_SIZE) /* WRITPAGE command reply length (+ busy time) */
+#else
+#define WRITPAGE_RPLYLN (1 + CHECKSUM_SIZE) /* WRITPAGE command reply length */
+#endif                                      /* WRITPAGE_BUSY */
 #define READDEVS_RPLYLN 10 /* READDEVS command reply length */
 #define WRITEEPR_RPLYLN 2  /* WRITEEPR command reply length */
 #define READEEPR_RPLYLN 3  /* READEEPR command reply length */
+#define GETPGCRC_MAXPG (SLV_PACKET_SIZE / 2) /* GETPGCRC maximum pages per reply */
+#define GETWSTAT_RPLYLN 5  /* GETWSTAT command reply length */
+#define WRITPAGZ_RPLYLN (2 + CHECKSUM_SIZE) /* WRITPAGZ command reply length */
+#define WRITPAGZ_MAXLN (MST_PACKET_SIZE - 1) /* WRITPAGZ maximum compressed data bytes */
+#define READSTRM_CRCLN 2   /* READSTRM stream CRC-16 length */
+#define WRITEEPB_MAXLN MST_PACKET_SIZE /* WRITEEPB maximum data bytes */
+#define WRITEEPB_CMDLN (4 + WRITEEPB_MAXLN + CHECKSUM_SIZE) /* WRITEEPB command maximum length */
+#define WRITEEPB_RPLYLN (2 + CHECKSUM_SIZE) /* WRITEEPB command reply length */
+#define READEEPB_MAXLN SLV_PACKET_SIZE /* READEEPB maximum data bytes */
+#define READSTAT_RPLYLN 19 /* READSTAT command reply length */
+#define TUNEOSCC_RPLYLN 8  /* TUNEOSCC command reply length */
+#define GETIMCRC_RPLYLN 4  /* GETIMCRC command reply length */
 
 // Memory page definitions
-#define RESET_PAGE 0 /* Interrupt vector table address start location. */
+#define RESET_PAGE 0    /* Interrupt vector table address start location. */
+#if (AUTO_PAGE_ADDR && !(APP_USE_TPL_PG))
+#define APP_LIMIT (TIMONEL_START - SPM_PAGESIZE) /* The trampoline page isn't available to the application. */
+#else
+#define APP_LIMIT TIMONEL_START /* The application can use up to the bootloader start. */
+#endif                          /* AUTO_PAGE_ADDR && !APP_USE_TPL_PG */
+#define PAGE_SPM_MS 5   /* Flash page erase or write time (4.5 ms), the CPU is halted meanwhile. */
+#define TPL_PAGE (TIMONEL_START - SPM_PAGESIZE) /* Trampoline page address. */
+
+// A/B application slots: page 0 and the trampoline page are kept by Timonel
+#define SLOT_SIZE ((((TIMONEL_START - (2 * SPM_PAGESIZE)) / 2) / SPM_PAGESIZE) * SPM_PAGESIZE) /* Slot size. */
+#define SLOT_A_START SPM_PAGESIZE              /* Slot A address, applications are linked to start here. */
+#define SLOT_B_START (SLOT_A_START + SLOT_SIZE) /* Slot B address, applications are linked to start here. */
+#define RJMP(from, to) (0xC000 | (((((to) - (from)) / 2) - 1) & 0x0FFF)) /* "rjmp" between byte addresses. */
+
+// Fast resume session token
+#define SESSION_TOKEN 0x5E55 /* Value left in SRAM by DELFLASH to restart already initialized. */
+
+// Runtime statistics
+#define STATS_MAGIC 0x57A7 /* Value kept along with the statistics counters while they are valid. */
+#define STATS_TICK_CLKS 1024 /* CPU clock cycles per slow-op time tick (timer 0 prescaler). */
+
+// Application warm entry key
+#define WARM_ENTRY_KEY 0xB0 /* Value left in GPIOR0 by the application to enter Timonel initialized. */
 
 // Fuses' constants
 #ifndef LOW_FUSE           /* When AUTO_CLK_TWEAK is disabled, this value must match the low fuse */
@@ -191,11 +462,21 @@ typedef struct m_pack {
 #define LONG_EXIT_DLY 0x30  /* Short exit delay */
 #define SHORT_LED_DLY 0xFF  /* Long led delay */
 #define LONG_LED_DLY 0x1FF  /* Short led delay */
+#define WDT_TICK_MS 16      /* Watchdog interrupt mode period used to time EXIT_TIMEOUT_MS and TUNEOSCC trials */
 
 // CPU clock calibration value
 #define OSC_FAST 0x4C /* Offset for when the low fuse is set below 16 MHz.   */
                       /* NOTE: The sum of this value plus the factory OSCCAL */
                       /* value is shown in the GETTMNLV command.             */
+#define OSC_RANGE_BIT 7        /* OSCCAL frequency range bit, TUNEOSCC can't cross ranges */
+#define OSC_TRIAL_MS 250       /* Time to confirm a TUNEOSCC trial setting, timed by the watchdog */
+#define OSC_TRIAL_TICKS (((OSC_TRIAL_MS + WDT_TICK_MS - 1) / WDT_TICK_MS) + 1) /* Plus the partial first tick */
+
+// GETIMCRC calculation
+#define IMCRC_STEP_SIZE 32 /* Flash bytes added to the GETIMCRC CRC each main loop cycle */
+#define IMCRC_READY 0x00   /* GETIMCRC status: the CRC of the range is ready */
+#define IMCRC_BUSY 0x01    /* GETIMCRC status: the CRC is being calculated, ask again */
+#define IMCRC_BADRNG 0xFF  /* GETIMCRC status: the range isn't within [0, TIMONEL_START) */
 
 // Erase temporary page buffer macro
 #define BOOT_TEMP_BUFF_ERASE (_BV(__SPM_ENABLE) | _BV(CTPB))
@@ -289,20 +570,59 @@ typedef struct m_pack {
 #define EF_BIT_5 32
 #else
 #define EF_BIT_5 0
-#endif             /* EEPROM_ACCESS */
-#define EF_BIT_6 0 /* EF Bit 6 not used */
-#define EF_BIT_7 0 /* EF Bit 7 not used */
+#endif /* EEPROM_ACCESS */
+#if (CMD_GETPGCRC == true)
+#define EF_BIT_6 64
+#else
+#define EF_BIT_6 0
+#endif /* CMD_GETPGCRC */
+#if (USE_CRC16 == true)
+#define EF_BIT_7 128
+#else
+#define EF_BIT_7 0
+#endif /* USE_CRC16 */
 
 #define TML_EXT_FEATURES (EF_BIT_7 + EF_BIT_6 + EF_BIT_5 + EF_BIT_4 + EF_BIT_3 + EF_BIT_2 + EF_BIT_1 + EF_BIT_0)
 
+#if FAST_RESUME
+// Session token and its complement, they aren't initialized at startup so they survive the restart
+static uint16_t session_token __attribute__((section(".noinit")));
+static uint16_t session_check __attribute__((section(".noinit")));
+#endif /* FAST_RESUME */
+
+#if CMD_READSTAT
+// Runtime statistics counters, they aren't initialized at startup so they survive the restarts
+typedef struct r_stats {
+    uint16_t magic;        // STATS_MAGIC while the counters are valid
+    uint8_t reset_flags;   // MCUSR reset flags of the last restart
+    uint16_t restarts;     // Timonel starts since the counters were cleared
+    uint16_t rejected;     // WRITPAGE, WRITPAGZ and WRITEEPB packets rejected by checksum
+    uint16_t del_flash;    // DELFLASH runs (also triggered by a checksum error or a trampoline overwrite)
+    uint16_t broadcasts;   // General call commands run
+    uint16_t pages;        // Flash pages written
+    uint32_t slow_ticks;   // Time spent in slow-ops, in STATS_TICK_CLKS CPU clock cycles units
+} RunStats;
+static RunStats run_stats __attribute__((section(".noinit")));
+#endif /* CMD_READSTAT */
+
 /////////////////////////////////////////////////////////////////////////////
 ////////////      ALL USI TWI DRIVER CONFIG BELOW THIS LINE      ////////////
 /////////////////////////////////////////////////////////////////////////////
 
 // Driver buffer definitions
 // Allowed RX buffer sizes: 1, 2, 4, 8, 16, 32, 64, 128 or 256
+// By default, the RX buffer is sized to hold a whole WRITPAGE (or WRITEEPB) packet.
+// When the page data is streamed, it only has to hold the longest non-data command.
 #ifndef TWI_RX_BUFFER_SIZE
+#if (STREAM_PAGE_FILL && !(CMD_WRITPAGZ) && !(EEPROM_BLOCKS))
+#define TWI_RX_BUFFER_SIZE 16
+#elif ((MST_PACKET_SIZE + 1 + CHECKSUM_SIZE) > 128)
+#define TWI_RX_BUFFER_SIZE 256
+#elif (((MST_PACKET_SIZE + 1 + CHECKSUM_SIZE) > 64) || (EEPROM_BLOCKS && (WRITEEPB_CMDLN > 64)))
+#define TWI_RX_BUFFER_SIZE 128
+#else
 #define TWI_RX_BUFFER_SIZE 64
+#endif /* MST_PACKET_SIZE + 1 + CHECKSUM_SIZE > 64 */
 #endif /* TWI_RX_BUFFER_SIZE */
 
 #define TWI_RX_BUFFER_MASK (TWI_RX_BUFFER_SIZE - 1)
@@ -312,8 +632,15 @@ typedef struct m_pack {
 #endif /* TWI_RX_BUFFER_SIZE & TWI_RX_BUFFER_MASK */
 
 // Allowed TX buffer sizes: 1, 2, 4, 8, 16, 32, 64, 128 or 256
+// By default, the TX buffer is sized to hold the longest reply (READFLSH or GETPGCRC)
 #ifndef TWI_TX_BUFFER_SIZE
+#if ((SLV_PACKET_SIZE + 1 + CHECKSUM_SIZE) > 127)
+#define TWI_TX_BUFFER_SIZE 256
+#elif ((SLV_PACKET_SIZE + 1 + CHECKSUM_SIZE) > 63)
+#define TWI_TX_BUFFER_SIZE 128
+#else
 #define TWI_TX_BUFFER_SIZE 64
+#endif /* SLV_PACKET_SIZE + 1 + CHECKSUM_SIZE > 63 */
 #endif /* TWI_TX_BUFFER_SIZE */
 
 #define TWI_TX_BUFFER_MASK (TWI_TX_BUFFER_SIZE - 1)
@@ -360,6 +687,49 @@ static OverflowState device_state;
 #define TWI_COLLISION_FLAG USIDC    // This status register flag indicates that a data output collision occurred on the bus
 #define TWI_START_COND_INT USISIE   // This control register bit defines whether an I2C START condition will trigger an interrupt
 #define USI_OVERFLOW_INT USIOIE     // This control register bit defines whether an USI 4-bit counter overflow will trigger an interrupt
+#define WDT_CTRL_REG WDTCR          // Watchdog timer control register
+#define TMR0_FLAG_REG TIFR          // Timer 0 interrupt flag register
+#define TMR0_CLK_1024 ((1 << CS02) | (1 << CS00))  // Timer 0 clock: CPU clock / 1024
 #endif                              // ATtinyX5
 
+#if defined(__AVR_ATtiny24__) | \
+    defined(__AVR_ATtiny44__) | \
+    defined(__AVR_ATtiny84__)
+#define DDR_USI DDRA
+#define PORT_USI PORTA
+#define PIN_USI PINA
+#define PORT_USI_SDA PORTA6
+#define PORT_USI_SCL PORTA4
+#define PIN_USI_SDA PINA6
+#define PIN_USI_SCL PINA4
+#define TWI_START_COND_FLAG USISIF  // This status register flag indicates that an I2C START condition occurred on the bus (can trigger an interrupt)
+#define USI_OVERFLOW_FLAG USIOIF    // This status register flag indicates that the bits reception or transmission is complete (can trigger an interrupt)
+#define TWI_STOP_COND_FLAG USIPF    // This status register flag indicates that an I2C STOP condition occurred on the bus
+#define TWI_COLLISION_FLAG USIDC    // This status register flag indicates that a data output collision occurred on the bus
+#define TWI_START_COND_INT USISIE   // This control register bit defines whether an I2C START condition will trigger an interrupt
+#define USI_OVERFLOW_INT USIOIE     // This control register bit defines whether an USI 4-bit counter overflow will trigger an interrupt
+#define WDT_CTRL_REG WDTCSR         // Watchdog timer control register
+#define TMR0_FLAG_REG TIFR0         // Timer 0 interrupt flag register
+#define TMR0_CLK_1024 ((1 << CS02) | (1 << CS00))  // Timer 0 clock: CPU clock / 1024
+#endif                              // ATtinyX4
+
+#if defined(__AVR_ATtiny87__)       // USI on its default pins (USIPP = 0), 128-byte flash pages
+#define DDR_USI DDRB
+#define PORT_USI PORTB
+#define PIN_USI PINB
+#define PORT_USI_SDA PB0
+#define PORT_USI_SCL PB2
+#define PIN_USI_SDA PINB0
+#define PIN_USI_SCL PINB2
+#define TWI_START_COND_FLAG USISIF  // This status register flag indicates that an I2C START condition occurred on the bus (can trigger an interrupt)
+#define USI_OVERFLOW_FLAG USIOIF    // This status register flag indicates that the bits reception or transmission is complete (can trigger an interrupt)
+#define TWI_STOP_COND_FLAG USIPF    // This status register flag indicates that an I2C STOP condition occurred on the bus
+#define TWI_COLLISION_FLAG USIDC    // This status register flag indicates that a data output collision occurred on the bus
+#define TWI_START_COND_INT USISIE   // This control register bit defines whether an I2C START condition will trigger an interrupt
+#define USI_OVERFLOW_INT USIOIE     // This control register bit defines whether an USI 4-bit counter overflow will trigger an interrupt
+#define WDT_CTRL_REG WDTCR          // Watchdog timer control register
+#define TMR0_FLAG_REG TIFR0         // Timer 0 interrupt flag register
+#define TMR0_CLK_1024 ((1 << CS02) | (1 << CS01) | (1 << CS00))  // Timer 0 clock: CPU clock / 1024 (asynchronous timer prescaler)
+#endif                              // ATtiny87
+
 #endif  // TML_CONFIG_H
@@ -18,9 +18,19 @@ if [ "$1" != "" ]; then
     payload=$1;
 	if [ $payload == "-h" ] || [ $payload == "--h" ] || [ $payload == "-help" ] || [ $payload == "--help" ] || [ $payload == "-?"  ]; then
         echo "";
-        echo "Usage: MAKE_PAYLOAD path_to_hexfile";
+        echo "Usage: MAKE_PAYLOAD path_to_hexfile [path_to_hexfile ...]";
         exit 1;
     fi
+    if [ $# -gt 1 ]; then
+        # Batch: all the payloads in one run, in parallel, skipping the unchanged ones ...
+        echo "Parsing" $# "files ...";
+        if [ `uname | grep Linux` ]; then
+            .pio/build/native/tml-hexparser --jobs 0 --cache ./appl-payload/.tml-hexparser.cache --output-dir ./appl-payload "$@";
+        else
+            .pio/build/native/tml-hexparser.exe --jobs 0 --cache ./appl-payload/.tml-hexparser.cache --output-dir ./appl-payload "$@";
+        fi
+        exit $?;
+    fi
     if [ ! -f $payload ]; then
         echo "";
         echo "Binary file not found!";
@@ -37,7 +47,7 @@ if [ "$1" != "" ]; then
 	fi	
 else
 	echo "";
-    echo "Usage: MAKE_PAYLOAD path_to_hexfile";
+    echo "Usage: MAKE_PAYLOAD path_to_hexfile [path_to_hexfile ...]";
     exit 1;
 fi
 
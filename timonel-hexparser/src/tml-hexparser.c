@@ -1,7 +1,7 @@
 /*
  ********************************************************
  * Timonel Intel Hex Parser                             *
- * Version: 0.4 "Cati" | For Unix & Windows             *
+ * Version: 0.5 "Cati" | For Unix & Windows             *
  * .................................................... *
  * 2020-05-10 gustavo.casanova@nicebots.com             *
  * .................................................... *
@@ -23,37 +23,149 @@
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
+#if !defined(WIN) && !defined(_WIN32)
+  #include <pthread.h>
+  #include <unistd.h>
+  #define TML_THREADS 1
+#endif
 
 #define FILE_TYPE_INTEL_HEX 1
 #define FILE_TYPE_RAW 2
+#define OUTPUT_FORMAT_ARRAY 1
+#define OUTPUT_FORMAT_PAGES 2
+#define OUTPUT_FORMAT_RLE 3
+#define OUTPUT_FORMAT_BIN 4
+#define OUTPUT_FORMAT_TPK 5
+#define OUTPUT_FORMAT_UPDATER 6
+#define DEFAULT_PACKET_SIZE 32
+#define DEFAULT_PAGE_SIZE 64
+#define MAX_PAGE_SIZE 256
 #define DEBUGLVL 1
 #define BYTESPERLINE 8
 
-#define TML_HEXPARSER_VERSION " Timonel Hex Parser version: 0.3"
+#define TML_HEXPARSER_VERSION " Timonel Hex Parser version: 0.5"
+
+#define MAX_INPUT_FILES 256
+#define MAX_RECORD_BYTES (255 + 5)   /* data + length, address, type and checksum */
+#define READ_CHUNK_SIZE 65536
+#define TPK_VERSION 1
+#define TPK_HEADER_SIZE 16
+#define DATA_BUFFER_SIZE (65536 + 256)
+#define MAX_JOBS 64
+#define UPDATER_SKIP_BYTES 16   /* trampoline baked into the bootloader image, the updater makes its own */
+#define UPDATER_MIN_START 100
+#define JOB_CONVERTED 0
+#define JOB_FAILED 1
+#define JOB_CACHED 2
+
+// Supported target MCUs: name, device signature, flash size and page size
+typedef struct {
+  const char *name;
+  unsigned char signature[3];
+  int flashSize;
+  int pageSize;
+} TargetMcu;
+
+static const TargetMcu targetMcus[] = {
+  {"attiny85", {0x1E, 0x93, 0x0B}, 8192, 64},
+  {"attiny45", {0x1E, 0x92, 0x06}, 4096, 64},
+  {"attiny25", {0x1E, 0x91, 0x08}, 2048, 32},
+  {"attiny84", {0x1E, 0x93, 0x0C}, 8192, 64},
+  {"attiny44", {0x1E, 0x92, 0x07}, 4096, 64},
+  {"attiny24", {0x1E, 0x91, 0x0B}, 2048, 32},
+  {"attiny87", {0x1E, 0x93, 0x87}, 8192, 128},
+};
+
+// Conversion settings, the same for all the input files
+typedef struct {
+  int fileType;
+  int outputFormat;
+  int pageSize;
+  int packetSize;
+  int limit;
+  int named;                  /* name each payload after its file */
+  const TargetMcu *mcu;
+  const char *outputDir;
+} ParserSettings;
+
+// Batch job: one input file and its conversion result
+typedef struct {
+  char *file;
+  char path[1024];            /* output file, when there is an output folder */
+  unsigned long long hash;    /* input content and settings hash, for the cache */
+  int status;
+} ParserJob;
+
+// Content-hash cache entry: output file and the hash it was made from
+typedef struct {
+  char *path;
+  unsigned long long hash;
+} CacheEntry;
+
+// Batch worker queue
+typedef struct {
+  const ParserSettings *settings;
+  ParserJob *jobs;
+  int jobCount;
+  int next;
+#if TML_THREADS
+  pthread_mutex_t lock;
+#endif
+} JobQueue;
 
 // Global definitions
-unsigned char dataBuffer[65536 + 256];    /* file data buffer */
+static signed char hexValue[256];         /* hex digit lookup table, -1: not a hex digit */
+static CacheEntry *cacheEntries = NULL;   /* loaded before the workers start, read-only while they run */
+static int cacheCount = 0;
 
 // Function prototypes
 static int parseRaw(char *hexfile, unsigned char *buffer, int *startAddr, int *endAddr);
-static int parseIntelHex(char *hexfile, unsigned char *buffer, int *startAddr, int *endAddr); /* taken from bootloadHID */
-static int parseUntilColon(FILE *fp); /* taken from bootloadHID */
-static int parseHex(FILE *fp, int numDigits); /* taken from bootloadHID */
+static int parseIntelHex(char *hexfile, char *content, size_t length, unsigned char *buffer, int *startAddr, int *endAddr);
+static int readFile(char *filename, char **content, size_t *length);
+static void initHexTable(void);
+static void printPayload(FILE *output, const char *name, unsigned char *buffer, int startAddr, int endAddr);
+static void printPages(FILE *output, const char *name, unsigned char *buffer, int endAddr, int pageSize);
+static unsigned int crc16Xmodem(unsigned int crc, unsigned char data);
+static int printRle(FILE *output, const char *name, unsigned char *buffer, int endAddr, int pageSize, int packetSize);
+static int rleEncode(const unsigned char *data, int length, unsigned char *encoded);
+static int rleDecode(const unsigned char *encoded, int length, unsigned char *data, int maxLength);
+static int writeBin(FILE *output, unsigned char *buffer, int endAddr, int limit);
+static int writeTpk(FILE *output, unsigned char *buffer, int endAddr, int pageSize, const TargetMcu *mcu, int limit);
+static void putWord(unsigned char *data, unsigned int value);
+static int printUpdater(FILE *output, const char *filename, unsigned char *buffer, int endAddr);
+static void outputPath(const char *outputDir, const char *filename, const char *extension, char *path, size_t size);
+static FILE *openOutput(const char *path, const char *mode);
+static int convertFile(const ParserSettings *settings, ParserJob *job, unsigned char *buffer);
+static void *convertWorker(void *arg);
+static int runJobs(JobQueue *queue, int jobCount);
+static unsigned long long hashBytes(unsigned long long hash, const void *data, size_t length);
+static void loadCache(const char *cacheFile);
+static int saveCache(const char *cacheFile, ParserJob *jobs, int jobCount);
+static int cachedHash(const char *path, unsigned long long *hash);
+static void payloadName(const char *filename, char *name, size_t size);
 static int use_ansi = 0;
 
 // Main function
 int main(int argc, char *argv[]) {
-  int res;
-  char *file = NULL;
+  char *files[MAX_INPUT_FILES];
+  int file_count = 0;
+  char *output_dir = NULL;
+  char *cache_file = NULL;
+  int jobs = 1;
 
   // Command argument parsing
   int run = 0;
   int file_type = FILE_TYPE_INTEL_HEX;
+  int output_format = OUTPUT_FORMAT_ARRAY;
+  int page_size = DEFAULT_PAGE_SIZE;
+  int packet_size = DEFAULT_PACKET_SIZE;
+  const TargetMcu *mcu = &targetMcus[0];
+  int limit = 0;
   int arg_pointer = 1;
   #if defined(WIN)
-    char* usage = "\n Timonel Intel Hex Parser\n ========================\n usage: tml-hexparser [--help] [--type intel-hex|raw] filename";
+    char* usage = "\n Timonel Intel Hex Parser\n ========================\n usage: tml-hexparser [--help] [--type intel-hex|raw] [--format array|pages|rle|bin|tpk|updater] [--output-dir dir] [--jobs n] [--cache file] filename [filename ...]";
   #else
-    char* usage = "\n Timonel Intel Hex Parser\n ========================\n usage: tml-hexparser [--help] [--type intel-hex|raw] filename [--no-ansi]\n";
+    char* usage = "\n Timonel Intel Hex Parser\n ========================\n usage: tml-hexparser [--help] [--type intel-hex|raw] [--format array|pages|rle|bin|tpk|updater] [--output-dir dir] [--jobs n] [--cache file] filename [filename ...] [--no-ansi]\n";
   #endif 
   #if defined(WIN)
     use_ansi = 0;
@@ -75,6 +187,55 @@ int main(int argc, char *argv[]) {
         printf("Unknown File Type specified with --type option");
         return EXIT_FAILURE;
       }
+    } else if (strcmp(argv[arg_pointer], "--format") == 0 && arg_pointer + 1 < argc) {
+      arg_pointer += 1;
+      if (strcmp(argv[arg_pointer], "array") == 0) {
+        output_format = OUTPUT_FORMAT_ARRAY;
+      } else if (strcmp(argv[arg_pointer], "pages") == 0) {
+        output_format = OUTPUT_FORMAT_PAGES;
+      } else if (strcmp(argv[arg_pointer], "rle") == 0) {
+        output_format = OUTPUT_FORMAT_RLE;
+      } else if (strcmp(argv[arg_pointer], "bin") == 0) {
+        output_format = OUTPUT_FORMAT_BIN;
+      } else if (strcmp(argv[arg_pointer], "tpk") == 0) {
+        output_format = OUTPUT_FORMAT_TPK;
+      } else if (strcmp(argv[arg_pointer], "updater") == 0) {
+        output_format = OUTPUT_FORMAT_UPDATER;
+      } else {
+        printf("Unknown output format specified with --format option");
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[arg_pointer], "--mcu") == 0 && arg_pointer + 1 < argc) {
+      arg_pointer += 1;
+      int i, mcu_count = sizeof(targetMcus) / sizeof(targetMcus[0]);
+      for (i = 0; i < mcu_count && strcmp(argv[arg_pointer], targetMcus[i].name) != 0; i++);
+      if (i == mcu_count) {
+        printf("Unknown target MCU specified with --mcu option");
+        return EXIT_FAILURE;
+      }
+      mcu = &targetMcus[i];
+      page_size = mcu->pageSize;
+    } else if (strcmp(argv[arg_pointer], "--limit") == 0 && arg_pointer + 1 < argc) {
+      arg_pointer += 1;
+      limit = (int)strtol(argv[arg_pointer], NULL, 16);
+      if (limit <= 0 || limit > 65536) {
+        printf("The limit must be a hexadecimal address between 1 and 10000");
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[arg_pointer], "--page-size") == 0 && arg_pointer + 1 < argc) {
+      arg_pointer += 1;
+      page_size = atoi(argv[arg_pointer]);
+      if (page_size < 2 || page_size > MAX_PAGE_SIZE || (page_size & (page_size - 1))) {
+        printf("The page size must be a power of 2 between 2 and %d", MAX_PAGE_SIZE);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[arg_pointer], "--packet-size") == 0 && arg_pointer + 1 < argc) {
+      arg_pointer += 1;
+      packet_size = atoi(argv[arg_pointer]);
+      if (packet_size < 4 || packet_size > MAX_PAGE_SIZE) {
+        printf("The packet size must be between 4 and %d", MAX_PAGE_SIZE);
+        return EXIT_FAILURE;
+      }
     } else if (strcmp(argv[arg_pointer], "--help") == 0 || strcmp(argv[arg_pointer], "-h") == 0) {
       puts(usage);
       puts("");
@@ -83,151 +244,839 @@ int main(int argc, char *argv[]) {
       #ifndef WIN
       puts("                --no-ansi: Don't use ANSI in terminal output");
       #endif
+      puts("--format [array, pages, rle, bin, tpk, updater]: Output a dense byte array");
+      puts("                           from address 0 (default), a table of the");
+      puts("                           non-blank flash pages with their CRC-16/XMODEM,");
+      puts("                           run-length compressed WRITPAGZ packets, a raw");
+      puts("                           binary image, a packed binary page table (see");
+      puts("                           README), or the Timonel Updater bootloader data");
+      puts("         --page-size size: Flash page size for the pages, rle and tpk");
+      puts("                           formats (default: the --mcu one, 64)");
+      puts("               --mcu name: Target MCU for the tpk format: attiny25/45/85,");
+      puts("                           attiny24/44/84 or attiny87 (default attiny85)");
+      puts("             --limit addr: Hexadecimal TIMONEL_START, the bin and tpk images");
+      puts("                           must end below it (default: the flash size)");
+      puts("       --packet-size size: Timonel MST_PACKET_SIZE for the rle format, each");
+      puts("                           packet carries up to size - 1 bytes (default 32)");
+      puts("         --output-dir dir: Write each payload to \"dir/<filename>.h\" (.bin,");
+      puts("                           .tpk or .c) instead of the standard output");
+      puts("                 --jobs n: With --output-dir, convert n files in parallel");
+      puts("                           (default 1, 0: one per CPU)");
+      puts("             --cache file: With --output-dir, skip the files whose content and");
+      puts("                           settings didn't change since they were converted");
       puts("                 filename: Path to Intel Hex or Raw data file,");
-      puts("                           or \"-\" to read from stdin");
+      puts("                           or \"-\" to read from stdin. When several");
+      puts("                           files are printed to the standard output,");
+      puts("                           each array is named after its file");
       puts("");
       puts(TML_HEXPARSER_VERSION);
       return EXIT_SUCCESS;
     } else if (strcmp(argv[arg_pointer], "--no-ansi") == 0) {
       use_ansi = 0;
+    } else if (strcmp(argv[arg_pointer], "--output-dir") == 0 && arg_pointer + 1 < argc) {
       arg_pointer += 1;
+      output_dir = argv[arg_pointer];
+    } else if (strcmp(argv[arg_pointer], "--jobs") == 0 && arg_pointer + 1 < argc) {
+      arg_pointer += 1;
+      jobs = atoi(argv[arg_pointer]);
+      if (jobs < 0 || jobs > MAX_JOBS) {
+        printf("The number of jobs must be between 0 and %d", MAX_JOBS);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[arg_pointer], "--cache") == 0 && arg_pointer + 1 < argc) {
+      arg_pointer += 1;
+      cache_file = argv[arg_pointer];
+    } else if (file_count < MAX_INPUT_FILES) {
+      files[file_count++] = argv[arg_pointer];
     } else {
-      file = argv[arg_pointer];
+      printf("// Too many input files, the maximum is %d\n", MAX_INPUT_FILES);
+      return EXIT_FAILURE;
     }
 
     arg_pointer += 1;
   }
 
-  if (argc < 2) {
+  if (argc < 2 || file_count == 0) {
     puts(usage);
     return EXIT_FAILURE;
   }
 
-  // Parsing user .Hex program file ...
+  // The binary formats have no comments, so only one payload can go to the standard output
+  int binary = (output_format == OUTPUT_FORMAT_BIN || output_format == OUTPUT_FORMAT_TPK);
+  if (binary && output_dir == NULL && file_count > 1) {
+    printf("// The bin and tpk formats need --output-dir to convert several files\n");
+    return EXIT_FAILURE;
+  }
+  if (limit == 0) {
+    limit = mcu->flashSize;
+  }
+
+  if (cache_file != NULL && output_dir == NULL) {
+    printf("// The --cache option needs --output-dir\n");
+    return EXIT_FAILURE;
+  }
+
+  // The output files are written in parallel only when each one goes to its own file
+  if (jobs == 0) {
+#if TML_THREADS
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    jobs = cpus < 1 ? 1 : cpus > MAX_JOBS ? MAX_JOBS : (int)cpus;
+#else
+    jobs = 1;
+#endif
+  }
+  if (output_dir == NULL) {
+    jobs = 1;
+  }
+
+  initHexTable();
+  if (cache_file != NULL) {
+    loadCache(cache_file);
+  }
+
+  // Parsing user .Hex program files ...
+  static ParserJob job_list[MAX_INPUT_FILES];
+  ParserSettings settings = {
+    .fileType = file_type,
+    .outputFormat = output_format,
+    .pageSize = page_size,
+    .packetSize = packet_size,
+    .limit = limit,
+    .named = output_dir == NULL && file_count > 1,
+    .mcu = mcu,
+    .outputDir = output_dir,
+  };
+  const char *extension = output_format == OUTPUT_FORMAT_BIN ? ".bin" : output_format == OUTPUT_FORMAT_TPK ? ".tpk" :
+                          output_format == OUTPUT_FORMAT_UPDATER ? ".c" : ".h";
+  for (int file_ix = 0; file_ix < file_count; file_ix++) {
+    job_list[file_ix].file = files[file_ix];
+    job_list[file_ix].path[0] = '\0';
+    if (output_dir != NULL) {
+      outputPath(output_dir, files[file_ix], extension, job_list[file_ix].path, sizeof(job_list[file_ix].path));
+    }
+  }
+  JobQueue queue = { .settings = &settings, .jobs = job_list, .jobCount = file_count, .next = 0 };
+  if (runJobs(&queue, jobs)) {
+    return EXIT_FAILURE;
+  }
+
+  int failures = 0, cached = 0;
+  for (int file_ix = 0; file_ix < file_count; file_ix++) {
+    failures += job_list[file_ix].status == JOB_FAILED;
+    cached += job_list[file_ix].status == JOB_CACHED;
+  }
+  if (cache_file != NULL) {
+    printf("// %d files converted, %d unchanged, %d failed\n", file_count - cached - failures, cached, failures);
+    if (saveCache(cache_file, job_list, file_count)) {
+      failures++;
+    }
+  }
+
+  if (!binary || output_dir != NULL) {
+    printf("// Timonel Hex Parser done. Thank you!\n//\n");
+  }
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Function convertFile: parses one input file and writes its payload
+static int convertFile(const ParserSettings *settings, ParserJob *job, unsigned char *buffer) {
+  char *file = job->file;
   int startAddress = 1, endAddress = 0;
 
-  memset(dataBuffer, 0xFF, sizeof(dataBuffer));
+  memset(buffer, 0xFF, DATA_BUFFER_SIZE);
 
-  if (file_type == FILE_TYPE_INTEL_HEX) {
-    if (parseIntelHex(file, dataBuffer, &startAddress, &endAddress)) {
-      printf("// Error loading or parsing hex file!\n");
-      return EXIT_FAILURE;
+  if (settings->fileType == FILE_TYPE_INTEL_HEX) {
+    char *content;
+    size_t length;
+    if (readFile(file, &content, &length)) {
+      printf("// Error loading or parsing hex file %s!\n", file);
+      return JOB_FAILED;
     }
-  } 
-  else if (file_type == FILE_TYPE_RAW) {
-    if (parseRaw(file, dataBuffer, &startAddress, &endAddress)) {
-      printf("// Error loading raw file!\n");
-      return EXIT_FAILURE;
+    // The hash covers the settings too, a file converted with other options isn't up to date
+    char options[128];
+    int options_len = snprintf(options, sizeof(options), "%s %d %d %d %d %s", TML_HEXPARSER_VERSION,
+                               settings->outputFormat, settings->pageSize, settings->packetSize,
+                               settings->limit, settings->mcu->name);
+    job->hash = hashBytes(hashBytes(14695981039346656037ULL, options, options_len), content, length);
+    unsigned long long previous;
+    FILE *existing;
+    if (job->path[0] != '\0' && cachedHash(job->path, &previous) && previous == job->hash &&
+        (existing = fopen(job->path, "rb")) != NULL) {
+      fclose(existing);
+      free(content);
+      return JOB_CACHED;
+    }
+    int error = parseIntelHex(file, content, length, buffer, &startAddress, &endAddress);
+    free(content);
+    if (error) {
+      printf("// Error loading or parsing hex file %s!\n", file);
+      return JOB_FAILED;
+    }
+#if ( DEBUGLVL > 0 )
+    char name[128] = "payload";
+    if (settings->named) {
+      payloadName(file, name, sizeof(name));
+    }
+    int binary = (settings->outputFormat == OUTPUT_FORMAT_BIN || settings->outputFormat == OUTPUT_FORMAT_TPK);
+    FILE *output = job->path[0] != '\0' ? openOutput(job->path, binary ? "wb" : "w") : stdout;
+    if (output == NULL) {
+      return JOB_FAILED;
+    }
+    if (settings->outputFormat == OUTPUT_FORMAT_BIN) {
+      error = writeBin(output, buffer, endAddress, settings->limit);
+    } else if (settings->outputFormat == OUTPUT_FORMAT_TPK) {
+      error = writeTpk(output, buffer, endAddress, settings->pageSize, settings->mcu, settings->limit);
+    } else if (settings->outputFormat == OUTPUT_FORMAT_UPDATER) {
+      error = printUpdater(output, file, buffer, endAddress);
+    } else if (settings->outputFormat == OUTPUT_FORMAT_PAGES) {
+      printPages(output, name, buffer, endAddress, settings->pageSize);
+    } else if (settings->outputFormat == OUTPUT_FORMAT_RLE) {
+      error = printRle(output, name, buffer, endAddress, settings->pageSize, settings->packetSize);
+    } else {
+      printPayload(output, name, buffer, startAddress, endAddress);
+    }
+    if (output != stdout) {
+      if (!binary) {
+        fprintf(output, "// Timonel Hex Parser done. Thank you!\n//\n");
+      }
+      fclose(output);
+      if (error) {
+        remove(job->path);   /* don't leave a truncated payload behind */
+      }
+    }
+#endif
+    return error ? JOB_FAILED : JOB_CONVERTED;
+  }
+  else if (settings->fileType == FILE_TYPE_RAW) {
+    if (parseRaw(file, buffer, &startAddress, &endAddress)) {
+      printf("// Error loading raw file %s!\n", file);
+      return JOB_FAILED;
     }
 
     if (startAddress >= endAddress) {
-      printf("// No data in input file, exiting!\n");
-      return EXIT_FAILURE;
+      printf("// No data in input file %s, skipping!\n", file);
+      return JOB_FAILED;
     }
-
   }
+  return JOB_CONVERTED;
+}
 
-  printf("// Timonel Hex Parser done. Thank you!\n//\n");
-
-  return EXIT_SUCCESS;
+// Function convertWorker: takes the next job from the queue until there are none left
+static void *convertWorker(void *arg) {
+  JobQueue *queue = arg;
+  unsigned char *buffer = malloc(DATA_BUFFER_SIZE);
+  while (1) {
+#if TML_THREADS
+    pthread_mutex_lock(&queue->lock);
+#endif
+    int job_ix = queue->next < queue->jobCount ? queue->next++ : -1;
+#if TML_THREADS
+    pthread_mutex_unlock(&queue->lock);
+#endif
+    if (job_ix < 0) break;
+    if (buffer == NULL) {
+      printf("//> Error converting %s: out of memory\n", queue->jobs[job_ix].file);
+      queue->jobs[job_ix].status = JOB_FAILED;
+      continue;
+    }
+    queue->jobs[job_ix].status = convertFile(queue->settings, &queue->jobs[job_ix], buffer);
+    fflush(stdout);
+  }
+  free(buffer);
+  return NULL;
 }
 
-// Function parseUntilColon
-static int parseUntilColon(FILE *file_pointer) {
-  int character;
+// Function runJobs: runs the queue on a pool of worker threads, the main thread being one of them
+static int runJobs(JobQueue *queue, int jobCount) {
+#if TML_THREADS
+  pthread_t threads[MAX_JOBS];
+  int started = 0;
+  if (jobCount > queue->jobCount) {
+    jobCount = queue->jobCount;
+  }
+  pthread_mutex_init(&queue->lock, NULL);
+  while (started < jobCount - 1 && pthread_create(&threads[started], NULL, convertWorker, queue) == 0) {
+    started++;
+  }
+  convertWorker(queue);
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  pthread_mutex_destroy(&queue->lock);
+#else
+  (void)jobCount;
+  convertWorker(queue);
+#endif
+  return 0;
+}
 
-  do {
-    character = getc(file_pointer);
-  } while(character != ':' && character != EOF);
+// Function hashBytes: 64-bit FNV-1a
+static unsigned long long hashBytes(unsigned long long hash, const void *data, size_t length) {
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
 
-  return character;
+// Function loadCache: one "<hash> <output file>" line per entry, a missing file is an empty cache
+static void loadCache(const char *cacheFile) {
+  char line[1100];
+  FILE *input = fopen(cacheFile, "r");
+  if (input == NULL) {
+    return;
+  }
+  while (fgets(line, sizeof(line), input) != NULL) {
+    unsigned long long hash;
+    int offset;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '#' || sscanf(line, "%16llx %n", &hash, &offset) != 1) {
+      continue;
+    }
+    CacheEntry *grown = realloc(cacheEntries, (cacheCount + 1) * sizeof(CacheEntry));
+    if (grown == NULL) {
+      break;
+    }
+    cacheEntries = grown;
+    cacheEntries[cacheCount].hash = hash;
+    cacheEntries[cacheCount].path = strdup(&line[offset]);
+    if (cacheEntries[cacheCount].path != NULL) {
+      cacheCount++;
+    }
+  }
+  fclose(input);
 }
-// Function parseHex
-static int parseHex(FILE *file_pointer, int num_digits) {
-  int iter;
-  char temp[9];
 
-  for(iter = 0; iter < num_digits; iter++) {
-    temp[iter] = getc(file_pointer);
+// Function cachedHash: hash the output file was made from in the previous runs
+static int cachedHash(const char *path, unsigned long long *hash) {
+  for (int i = 0; i < cacheCount; i++) {
+    if (strcmp(cacheEntries[i].path, path) == 0) {
+      *hash = cacheEntries[i].hash;
+      return 1;
+    }
   }
-  temp[iter] = 0;
+  return 0;
+}
 
-  return strtol(temp, NULL, 16);
+// Function saveCache: keeps the entries of the files that weren't in this run
+static int saveCache(const char *cacheFile, ParserJob *jobs, int jobCount) {
+  FILE *output = fopen(cacheFile, "w");
+  if (output == NULL) {
+    printf("//> Error creating %s: %s\n", cacheFile, strerror(errno));
+    return 1;
+  }
+  fprintf(output, "# Timonel Hex Parser cache: input hash and output file\n");
+  for (int i = 0; i < cacheCount; i++) {
+    int ix;
+    for (ix = 0; ix < jobCount && strcmp(jobs[ix].path, cacheEntries[i].path) != 0; ix++);
+    if (ix == jobCount) {
+      fprintf(output, "%016llx %s\n", cacheEntries[i].hash, cacheEntries[i].path);
+    }
+  }
+  for (int ix = 0; ix < jobCount; ix++) {
+    if (jobs[ix].status != JOB_FAILED) {
+      fprintf(output, "%016llx %s\n", jobs[ix].hash, jobs[ix].path);
+    }
+  }
+  return fclose(output) != 0;
 }
 
-// Function parseIntelHex
-static int parseIntelHex(char *hexfile, unsigned char *buffer, int *startAddr, int *endAddr) {
-  int address, base, d, segment, i, lineLen, sum;
-  FILE *input;
+// Function initHexTable
+static void initHexTable(void) {
+  memset(hexValue, -1, sizeof(hexValue));
+  for (int i = 0; i < 10; i++) {
+    hexValue['0' + i] = i;
+  }
+  for (int i = 0; i < 6; i++) {
+    hexValue['A' + i] = 10 + i;
+    hexValue['a' + i] = 10 + i;
+  }
+}
 
-  input = strcmp(hexfile, "-") == 0 ? stdin : fopen(hexfile, "r");
+// Function readFile: loads a whole file (or stdin) into memory
+static int readFile(char *filename, char **content, size_t *length) {
+  FILE *input = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "rb");
   if (input == NULL) {
-    printf("//> Error opening %s: %s\n", hexfile, strerror(errno));
+    printf("//> Error opening %s: %s\n", filename, strerror(errno));
     return 1;
   }
 
-  while (parseUntilColon(input) == ':') {
-    sum = 0;
-    sum += lineLen = parseHex(input, 2);
-    base = address = parseHex(input, 4);
-    sum += address >> 8;
-    sum += address;
-    sum += segment = parseHex(input, 2);  /* segment value? */
-    if (segment != 0) {   /* ignore lines where this byte is not 0 */
-      continue;
+  size_t capacity = 0;
+  *content = NULL;
+  *length = 0;
+  while (1) {
+    if (*length == capacity) {
+      capacity += READ_CHUNK_SIZE;
+      char *grown = realloc(*content, capacity);
+      if (grown == NULL) {
+        printf("//> Error reading %s: out of memory\n", filename);
+        free(*content);
+        if (input != stdin) fclose(input);
+        return 1;
+      }
+      *content = grown;
     }
+    size_t read_count = fread(*content + *length, 1, capacity - *length, input);
+    *length += read_count;
+    if (read_count == 0) break;
+  }
+
+  int error = ferror(input);
+  if (error) {
+    printf("//> Error reading %s: %s\n", filename, strerror(errno));
+    free(*content);
+  }
+  if (input != stdin) fclose(input);
+  return error ? 1 : 0;
+}
+
+// Function parseIntelHex: all record types are handled, extended segment (02) and
+// extended linear (04) addresses are applied to the data records that follow them
+static int parseIntelHex(char *hexfile, char *content, size_t length, unsigned char *buffer, int *startAddr, int *endAddr) {
+  unsigned char record[MAX_RECORD_BYTES];
+  unsigned long base = 0;
+  int line = 0, eof = 0, error = 0;
 
-    for (i = 0; i < lineLen; i++) {
-      d = parseHex(input, 2);
-      buffer[address++] = d;
-      sum += d;
+  char *position = content, *end = content + length;
+  while (position < end && !eof && !error) {
+    // Get the next line
+    char *line_end = memchr(position, '\n', end - position);
+    if (line_end == NULL) line_end = end;
+    char *p = position;
+    position = line_end + 1;
+    line++;
+
+    while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    if (p == line_end) continue;   /* empty line */
+    if (*p != ':') {
+      printf("//> Error: %s:%d: record doesn't start with ':'\n", hexfile, line);
+      error = 1;
+      break;
     }
+    p++;
 
-    sum += parseHex(input, 2);
-    if ((sum & 0xff) != 0) {
-      printf("//> Warning: Checksum error between address 0x%x and 0x%x\n", base, address);
+    // Decode the hex digit pairs through the lookup table
+    int count = 0;
+    while (p + 1 < line_end && hexValue[(unsigned char)p[0]] >= 0 && hexValue[(unsigned char)p[1]] >= 0) {
+      if (count == MAX_RECORD_BYTES) break;
+      record[count++] = (hexValue[(unsigned char)p[0]] << 4) | hexValue[(unsigned char)p[1]];
+      p += 2;
+    }
+    while (p < line_end && (*p == '\r' || *p == ' ' || *p == '\t')) p++;
+    if (p != line_end || count < 5 || count != record[0] + 5) {
+      printf("//> Error: %s:%d: malformed record\n", hexfile, line);
+      error = 1;
+      break;
     }
 
-    if(*startAddr > base) {
-      *startAddr = base;
+    unsigned char sum = 0;
+    for (int i = 0; i < count; i++) {
+      sum += record[i];
     }
-    if(*endAddr < address) {
-      *endAddr = address;
+    if (sum != 0) {
+      printf("//> Error: %s:%d: checksum error (record checksum 0x%02x, expected 0x%02x)\n",
+             hexfile, line, record[count - 1], (unsigned char)(record[count - 1] - sum));
+      error = 1;
+      break;
     }
 
+    int lineLen = record[0];
+    unsigned long offset = (record[1] << 8) | record[2];
+    switch (record[3]) {
+      case 0x00: {   /* data */
+        unsigned long address = base + offset;
+        if (address + lineLen > 65536) {
+          printf("//> Error: %s:%d: address 0x%lx out of range\n", hexfile, line, address);
+          error = 1;
+          break;
+        }
+        memcpy(&buffer[address], &record[4], lineLen);
+        if (*startAddr > (int)address) {
+          *startAddr = address;
+        }
+        if (*endAddr < (int)(address + lineLen)) {
+          *endAddr = address + lineLen;
+        }
+        break;
+      }
+      case 0x01: {   /* end of file */
+        eof = 1;
+        break;
+      }
+      case 0x02: {   /* extended segment address */
+        if (lineLen != 2) {
+          printf("//> Error: %s:%d: malformed extended segment address record\n", hexfile, line);
+          error = 1;
+          break;
+        }
+        base = ((unsigned long)((record[4] << 8) | record[5])) << 4;
+        break;
+      }
+      case 0x04: {   /* extended linear address */
+        if (lineLen != 2) {
+          printf("//> Error: %s:%d: malformed extended linear address record\n", hexfile, line);
+          error = 1;
+          break;
+        }
+        base = ((unsigned long)((record[4] << 8) | record[5])) << 16;
+        break;
+      }
+      case 0x03:     /* start segment address */
+      case 0x05: {   /* start linear address: the entry point isn't used by the AVR */
+        break;
+      }
+      default: {
+        printf("//> Error: %s:%d: unknown record type 0x%02x\n", hexfile, line, record[3]);
+        error = 1;
+        break;
+      }
+    }
   }
-  
-#if ( DEBUGLVL > 0 )
+
+  return error;
+}
+
+// Function printPayload
+static void printPayload(FILE *output, const char *name, unsigned char *buffer, int startAddr, int endAddr) {
+  int i, l = 0;
   // GC: Printing addresses
-  printf("\n//\n");
-  printf("// Start Address: 0x%x \n", *startAddr);
-  printf("// End Address: 0x%x \n//\n", *endAddr);
+  fprintf(output, "\n//\n");
+  fprintf(output, "// Start Address: 0x%x \n", startAddr);
+  fprintf(output, "// End Address: 0x%x \n//\n", endAddr);
   // GC: Printing payload array definition ...
-  //printf("const byte payldType = 0;    /* Application Payload */\n\n");
-  //printf("const byte payload[%i] = {", *endAddr + 1);
-  printf("uint8_t payload[%i] = {", *endAddr + 1);  
+  fprintf(output, "uint8_t %s[%i] = {", name, endAddr + 1);
 
-  
   // GC: Printing loaded buffer ...
-  printf("\n    ");
-    int l = 0;
-	for(i = 0; i <= *endAddr; i++) {
-		printf("0x%02x", buffer[i]);
-		if (i <= (*endAddr) - 1) {
-			printf(", ");
-		}
-		if (l++ == BYTESPERLINE - 1) {
-			printf("\n    ");
-			l = 0;
-		}
-	}
-	printf("\n};\n\n//\n");  
-#endif
- 
-  fclose(input);
+  fprintf(output, "\n    ");
+  for (i = 0; i <= endAddr; i++) {
+    fprintf(output, "0x%02x", buffer[i]);
+    if (i <= endAddr - 1) {
+      fprintf(output, ", ");
+    }
+    if (l++ == BYTESPERLINE - 1) {
+      fprintf(output, "\n    ");
+      l = 0;
+    }
+  }
+  fprintf(output, "\n};\n\n//\n");
+}
+
+// Function printPages: table of the pages that have data, all-0xFF pages are skipped.
+// Page 0 is always included, since it holds the reset vector.
+static void printPages(FILE *output, const char *name, unsigned char *buffer, int endAddr, int pageSize) {
+  int page_count = 0, page, i;
+  for (page = 0; page < endAddr; page += pageSize) {
+    for (i = 0; i < pageSize && buffer[page + i] == 0xFF; i++);
+    if (page == 0 || i < pageSize) {
+      page_count++;
+    }
+  }
+  fprintf(output, "\n//\n");
+  fprintf(output, "// End Address: 0x%x \n", endAddr);
+  fprintf(output, "// Pages: %d of %d bytes (%d blank pages skipped) \n//\n", page_count, pageSize,
+          (endAddr + pageSize - 1) / pageSize - page_count);
+  fprintf(output, "// Each entry holds the page address, the page CRC-16/XMODEM (polynomial 0x1021,\n");
+  fprintf(output, "// initial value 0x0000, as returned by GETPGCRC) and the page data. NOTE: Timonel\n");
+  fprintf(output, "// modifies the first page word (reset vector), so the CRC of page 0 read back from\n");
+  fprintf(output, "// the device differs.\n");
+  fprintf(output, "//\n");
+  fprintf(output, "#ifndef TML_PAYLOAD_PAGE_%d\n", pageSize);
+  fprintf(output, "#define TML_PAYLOAD_PAGE_%d\n", pageSize);
+  fprintf(output, "typedef struct {\n    uint16_t addr;\n    uint16_t crc;\n    uint8_t data[%d];\n} PayloadPage%d;\n", pageSize, pageSize);
+  fprintf(output, "#endif\n\n");
+  fprintf(output, "const uint16_t %s_page_count = %d;\n\n", name, page_count);
+  fprintf(output, "const PayloadPage%d %s_pages[%d] = {", pageSize, name, page_count);
+  for (page = 0; page < endAddr; page += pageSize) {
+    unsigned int crc = 0;
+    for (i = 0; i < pageSize && buffer[page + i] == 0xFF; i++);
+    if (page != 0 && i == pageSize) {
+      continue;
+    }
+    for (i = 0; i < pageSize; i++) {
+      crc = crc16Xmodem(crc, buffer[page + i]);
+    }
+    fprintf(output, "\n    {0x%04x, 0x%04x, {", page, crc);
+    for (i = 0; i < pageSize; i++) {
+      if (i % BYTESPERLINE == 0) {
+        fprintf(output, "\n        ");
+      }
+      fprintf(output, "0x%02x", buffer[page + i]);
+      if (i < pageSize - 1) {
+        fprintf(output, ", ");
+      }
+    }
+    fprintf(output, "\n    }},");
+  }
+  fprintf(output, "\n};\n\n//\n");
+}
+
+// Function crc16Xmodem: same as avr-libc "_crc_xmodem_update"
+static unsigned int crc16Xmodem(unsigned int crc, unsigned char data) {
+  int i;
+  crc ^= (unsigned int)data << 8;
+  for (i = 0; i < 8; i++) {
+    crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+  }
+  return crc & 0xFFFF;
+}
+
+// Function printRle: packets for all the pages from address 0, one per MST_PACKET_SIZE slot,
+// so they land at the same page offsets as plain WRITPAGE packets. Each one is a length byte and
+// the compressed data (WRITPAGZ), or a 0 length byte and the raw slot data (WRITPAGE) when the
+// compression doesn't save bus bytes, as with most AVR code.
+static int printRle(FILE *output, const char *name, unsigned char *buffer, int endAddr, int pageSize, int packetSize) {
+  unsigned char *stream = malloc(2 * DATA_BUFFER_SIZE);
+  unsigned char encoded[2 * MAX_PAGE_SIZE + 2], decoded[MAX_PAGE_SIZE];
+  int stream_len = 0, packets = 0, raw_packets = 0, page, i;
+  int page_bytes = (endAddr + pageSize - 1) / pageSize * pageSize;
+
+  if (stream == NULL) {
+    printf("//> Error: out of memory\n");
+    return 1;
+  }
+  if (packetSize > pageSize || pageSize % packetSize) {
+    printf("//> Error: the packet size must divide the page size\n");
+    free(stream);
+    return 1;
+  }
+  for (page = 0; page < page_bytes; page += pageSize) {
+    int position;
+    for (position = 0; position < pageSize; position += packetSize) {
+      int encoded_len = rleEncode(&buffer[page + position], packetSize, encoded);
+      if (rleDecode(encoded, encoded_len, decoded, sizeof(decoded)) != packetSize ||
+          memcmp(decoded, &buffer[page + position], packetSize)) {
+        printf("//> Error: RLE self-check failed at address 0x%x\n", page + position);
+        free(stream);
+        return 1;
+      }
+      // WRITPAGZ adds the length byte to the data, it's used only when it's shorter than WRITPAGE
+      if (encoded_len + 1 < packetSize) {
+        stream[stream_len++] = encoded_len;
+        memcpy(&stream[stream_len], encoded, encoded_len);
+        stream_len += encoded_len;
+      } else {
+        stream[stream_len++] = 0;
+        memcpy(&stream[stream_len], &buffer[page + position], packetSize);
+        stream_len += packetSize;
+        raw_packets++;
+      }
+      packets++;
+    }
+  }
+
+  fprintf(output, "\n//\n");
+  fprintf(output, "// End Address: 0x%x \n", endAddr);
+  fprintf(output, "// RLE payload: %d pages, %d packets (%d WRITPAGZ, %d WRITPAGE), %d bytes for %d page bytes (%d%%) \n//\n",
+          page_bytes / pageSize, packets, packets - raw_packets, raw_packets, stream_len - raw_packets, page_bytes,
+          page_bytes ? (stream_len - raw_packets) * 100 / page_bytes : 0);
+  fprintf(output, "// One packet for each %d-byte page slot, to be sent in order from page 0. A length byte\n", packetSize);
+  fprintf(output, "// from 1 up is followed by the compressed data, to be sent as \"WRITPAGZ, length, data,\n");
+  fprintf(output, "// checksum\". Control byte 0x00-0x7F: 1-128 literal bytes follow, 0x80-0xFF: the next byte\n");
+  fprintf(output, "// is repeated 2-129 times. A 0 length byte is followed by %d raw bytes, to be sent as\n", packetSize);
+  fprintf(output, "// \"WRITPAGE, data, checksum\". The byte count above is the packet data sent, without the 0s.\n");
+  fprintf(output, "//\n");
+  fprintf(output, "const uint16_t %s_rle_size = %d;\n\n", name, stream_len);
+  fprintf(output, "uint8_t %s_rle[%d] = {", name, stream_len);
+  for (i = 0; i < stream_len; i++) {
+    if (i % BYTESPERLINE == 0) {
+      fprintf(output, "\n    ");
+    }
+    fprintf(output, "0x%02x", stream[i]);
+    if (i < stream_len - 1) {
+      fprintf(output, ", ");
+    }
+  }
+  fprintf(output, "\n};\n\n//\n");
+  free(stream);
+  return 0;
+}
+
+// Function rleEncode: byte runs of 3 or more are repeated, the rest are literals. A 2-byte
+// run takes as many bytes repeated as literal, and it would split the literal block around it.
+static int rleEncode(const unsigned char *data, int length, unsigned char *encoded) {
+  int i = 0, n = 0;
+  while (i < length) {
+    int run = 1;
+    while (i + run < length && run < 129 && data[i + run] == data[i]) run++;
+    if (run >= 3) {
+      encoded[n++] = 0x80 | (run - 2);
+      encoded[n++] = data[i];
+      i += run;
+    } else {
+      int literal = 1;
+      while (i + literal < length && literal < 128) {
+        if (i + literal + 2 < length && data[i + literal] == data[i + literal + 1] &&
+            data[i + literal] == data[i + literal + 2]) {
+          break;
+        }
+        literal++;
+      }
+      encoded[n++] = literal - 1;
+      memcpy(&encoded[n], &data[i], literal);
+      n += literal;
+      i += literal;
+    }
+  }
+  return n;
+}
+
+// Function rleDecode: same as Timonel's "ExpandPacket", returns -1 on malformed data
+static int rleDecode(const unsigned char *encoded, int length, unsigned char *data, int maxLength) {
+  int i = 0, n = 0;
+  while (i < length) {
+    int control = encoded[i++];
+    int repeat = control & 0x80;
+    int count = repeat ? (control & 0x7F) + 2 : control + 1;
+    if (n + count > maxLength) return -1;
+    while (count-- > 0) {
+      if (i >= length) return -1;
+      data[n++] = encoded[i];
+      if (!repeat) i++;
+    }
+    if (repeat) i++;
+  }
+  return n;
+}
+
+// Function writeBin: raw binary image from address 0 to the end of the data, blank gaps as 0xFF
+static int writeBin(FILE *output, unsigned char *buffer, int endAddr, int limit) {
+  if (endAddr > limit) {
+    fprintf(stderr, "//> Error: the image ends at 0x%x, beyond the 0x%x limit\n", endAddr, limit);
+    return 1;
+  }
+  if (fwrite(buffer, 1, endAddr, output) != (size_t)endAddr) {
+    fprintf(stderr, "//> Error writing the binary image: %s\n", strerror(errno));
+    return 1;
+  }
+  return 0;
+}
+
+// Function writeTpk: packed page table, all the values little-endian. A 16-byte header ("TPK",
+// version, MCU signature, reserved, page size, limit, page count, image end), then one record
+// per non-blank page and page 0 (address, CRC-16/XMODEM, data), then the CRC-16 of all the above.
+static int writeTpk(FILE *output, unsigned char *buffer, int endAddr, int pageSize, const TargetMcu *mcu, int limit) {
+  unsigned char record[4 + MAX_PAGE_SIZE];
+  unsigned int crc = 0;
+  int page_count = 0, page, i;
+  if (endAddr > limit) {
+    fprintf(stderr, "//> Error: the image ends at 0x%x, beyond the 0x%x limit\n", endAddr, limit);
+    return 1;
+  }
+  for (page = 0; page < endAddr; page += pageSize) {
+    for (i = 0; i < pageSize && buffer[page + i] == 0xFF; i++);
+    if (page == 0 || i < pageSize) {
+      page_count++;
+    }
+  }
+  record[0] = 'T';
+  record[1] = 'P';
+  record[2] = 'K';
+  record[3] = TPK_VERSION;
+  memcpy(&record[4], mcu->signature, 3);
+  record[7] = 0;
+  putWord(&record[8], pageSize);
+  putWord(&record[10], limit);
+  putWord(&record[12], page_count);
+  putWord(&record[14], endAddr);
+  for (i = 0; i < TPK_HEADER_SIZE; i++) {
+    crc = crc16Xmodem(crc, record[i]);
+  }
+  int error = fwrite(record, 1, TPK_HEADER_SIZE, output) != TPK_HEADER_SIZE;
+  for (page = 0; page < endAddr && !error; page += pageSize) {
+    unsigned int page_crc = 0;
+    for (i = 0; i < pageSize && buffer[page + i] == 0xFF; i++);
+    if (page != 0 && i == pageSize) {
+      continue;
+    }
+    for (i = 0; i < pageSize; i++) {
+      page_crc = crc16Xmodem(page_crc, buffer[page + i]);
+    }
+    putWord(&record[0], page);
+    putWord(&record[2], page_crc);
+    memcpy(&record[4], &buffer[page], pageSize);
+    for (i = 0; i < 4 + pageSize; i++) {
+      crc = crc16Xmodem(crc, record[i]);
+    }
+    error = fwrite(record, 1, 4 + pageSize, output) != (size_t)(4 + pageSize);
+  }
+  putWord(&record[0], crc);
+  if (error || fwrite(record, 1, 2, output) != 2) {
+    fprintf(stderr, "//> Error writing the tpk payload: %s\n", strerror(errno));
+    return 1;
+  }
   return 0;
 }
 
+// Function printUpdater: Timonel Updater "bootloader_data.c", same as "generate-data.rb". The
+// bootloader bytes as little-endian words, from the first non-blank byte after the trampoline.
+static int printUpdater(FILE *output, const char *filename, unsigned char *buffer, int endAddr) {
+  int start = UPDATER_SKIP_BYTES, i;
+  while (start < endAddr && buffer[start] == 0xFF) {
+    start++;
+  }
+  if (start <= UPDATER_MIN_START || start >= endAddr) {
+    printf("//> Error: %s doesn't look like a bootloader, data found at 0x%x\n", filename, start);
+    return 1;
+  }
+  int words = (endAddr - start + 1) / 2;   /* an odd last byte is padded with 0xFF */
+  fprintf(output, "// This file contains the Timonel bootloader data itself and the\n");
+  fprintf(output, "// address to install it into flash memory.\n");
+  fprintf(output, "//\n");
+  fprintf(output, "// Timonel starting address: %d\n", start);
+  fprintf(output, "//\n");
+  fprintf(output, "// Generated from %s by the Timonel Hex Parser\n\n", filename);
+  fprintf(output, "const uint16_t bootloader_data[%d] PROGMEM = {", words);
+  for (i = 0; i < words; i++) {
+    if (i % BYTESPERLINE == 0) {
+      fprintf(output, "\n    ");
+    }
+    fprintf(output, "0x%04x", buffer[start + 2 * i] | (buffer[start + 2 * i + 1] << 8));
+    if (i < words - 1) {
+      fprintf(output, ", ");
+    }
+  }
+  fprintf(output, "\n};\n\n");
+  fprintf(output, "uint16_t bootloader_address = %d;\n\n", start);
+  return 0;
+}
+
+// Function putWord: 16-bit value, little-endian
+static void putWord(unsigned char *data, unsigned int value) {
+  data[0] = value & 0xFF;
+  data[1] = (value >> 8) & 0xFF;
+}
+
+// Function payloadName: C array name from the file name, e.g. "payload_sos_blink"
+static void payloadName(const char *filename, char *name, size_t size) {
+  const char *base = strrchr(filename, '/');
+  base = base != NULL ? base + 1 : filename;
+  size_t n = snprintf(name, size, "payload_");
+  for (; *base != '\0' && *base != '.' && n < size - 1; base++) {
+    char ch = *base;
+    name[n++] = ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')) ? ch : '_';
+  }
+  name[n] = '\0';
+}
+
+// Function outputPath: "dir/<filename without extension><extension>"
+static void outputPath(const char *outputDir, const char *filename, const char *extension, char *path, size_t size) {
+  const char *base = strrchr(filename, '/');
+  base = base != NULL ? base + 1 : filename;
+  const char *dot = strrchr(base, '.');
+  int base_len = dot != NULL ? (int)(dot - base) : (int)strlen(base);
+  snprintf(path, size, "%s/%.*s%s", outputDir, base_len, base, extension);
+}
+
+// Function openOutput
+static FILE *openOutput(const char *path, const char *mode) {
+  FILE *output = fopen(path, mode);
+  if (output == NULL) {
+    printf("//> Error creating %s: %s\n", path, strerror(errno));
+  }
+  return output;
+}
+
 //Function parseRaw
 static int parseRaw(char *filename, unsigned char *data_buffer, int *start_address, int *end_address) {
   FILE *input;
@@ -0,0 +1,527 @@
+/*
+ ********************************************************
+ * Timonel Host                                         *
+ * Version: 0.1 | For Linux (i2c-dev)                   *
+ * .................................................... *
+ * 2020-06-06 gustavo.casanova@nicebots.com             *
+ * .................................................... *
+ * Command line TWI master for Timonel. It uploads an   *
+ * application to one or more devices, running one      *
+ * thread per I2C bus, and reports the time spent in    *
+ * each phase.                                          *
+ ********************************************************
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tml-twim.h"
+
+#define TML_HOST_VERSION " Timonel Host version: 0.1"
+#define MAX_TARGETS 32
+
+// Operations requested on each target
+typedef struct options {
+    bool info;
+    bool enter;
+    uint8_t enter_command;
+    uint8_t enter_addr;
+    bool delete;
+    uint16_t delete_addr;
+    uint16_t delete_pages;
+    bool verify;
+    bool dev_stats;
+    bool clear_stats;
+    bool exit;
+    bool tune_osc;
+    bool interleave;
+    const char *file;
+    uint8_t image[TML_FLASH_SIZE];
+    uint16_t size;
+    const char *eeprom_file;
+    uint16_t eeprom_addr;
+    uint8_t eeprom_image[TML_FLASH_SIZE];
+    uint16_t eeprom_size;
+    const char *slot_file[2];
+    uint8_t slot_image[2][TML_FLASH_SIZE];
+    uint16_t slot_size[2];
+} Options;
+
+// One device to work with, and its outcome
+typedef struct target {
+    TmlDevice dev;
+    int result;
+    const char *failed_phase;
+    TmlDevStats dev_stats;
+    bool has_dev_stats;
+    uint8_t osccal;
+    bool erased;
+    TmlUploadJob upload;
+} Target;
+
+// All the targets on one I2C bus, handled by one thread
+typedef struct bus_job {
+    int bus;
+    Target *targets[MAX_TARGETS];
+    uint8_t count;
+    pthread_t thread;
+} BusJob;
+
+// Function prototypes
+static void *RunBus(void *arg);
+static void RunTarget(Target *target, int fd);
+static void RunInterleaved(BusJob *job, int fd);
+static void RunSetup(Target *target, int fd);
+static void RunFinish(Target *target);
+static int ParseTarget(const char *arg, int *bus, uint8_t *addr);
+static void PrintInfo(const Target *target);
+static void PrintStats(const Target *target);
+static void PrintDevStats(const Target *target);
+
+static Options options;
+
+// Main function
+int main(int argc, char *argv[]) {
+    static Target targets[MAX_TARGETS];
+    static BusJob jobs[MAX_TARGETS];
+    uint8_t target_count = 0;
+    uint8_t job_count = 0;
+    TmlDevice settings;
+    TmlDeviceInit(&settings, 0, 0);
+    char *usage = "\n Timonel Host\n ============\n usage: tml-host [--help] [options] bus:address [bus:address ...]\n";
+
+    // Command argument handling
+    for (int arg_pointer = 1; arg_pointer < argc; arg_pointer++) {
+        const char *arg = argv[arg_pointer];
+        const char *value = ((arg_pointer + 1) < argc) ? argv[arg_pointer + 1] : NULL;
+        if ((strcmp(arg, "--help") == 0) || (strcmp(arg, "-h") == 0)) {
+            puts(usage);
+            puts("          --info: Show the bootloader version and features");
+            puts(" --enter CMD[:A]: Send the application command CMD (at address A, default: the");
+            puts("                  target one) and wait for Timonel to answer (APP_WARM_ENTRY)");
+            puts("      --tune-osc: Calibrate the oscillator to the fastest error-free OSCCAL setting");
+            puts("                  before the other operations (CMD_OSCTUNE)");
+            puts("   --upload FILE: Upload an application (.hex Intel Hex or raw binary)");
+            puts("        --delete: Delete the application before uploading it, skipped if");
+            puts("                  Timonel erases each page on write (FORCE_ERASE_PG)");
+            puts(" --del-pages A:N: Delete N pages from address A, without restarting (CMD_DELPAGES)");
+            puts(" --eeprom A:FILE: Write a file to the EEPROM from address A (EEPROM_BLOCKS)");
+            puts("   --slots FA,FB: Upload the slot A or B image to the inactive slot and switch");
+            puts("                  to it (APP_AB_SLOTS)");
+            puts("        --verify: Check the application, by default reading it back with READFLSH,");
+            puts("                  and the EEPROM data, reading it back with READEEPB");
+            puts("     --dev-stats: Read the bootloader runtime statistics before exiting (CMD_READSTAT)");
+            puts("   --clear-stats: Read the runtime statistics and clear them (CMD_READSTAT)");
+            puts("          --exit: Exit the bootloader and run the application");
+            puts(" --packet-size N: WRITPAGE data bytes per packet (MST_PACKET_SIZE, default 32)");
+            puts("   --read-size N: READFLSH data bytes per reply (SLV_PACKET_SIZE, default 32)");
+            puts("   --read-stream: Verify with a single READSTRM stream (CMD_READSTRM)");
+            puts("--stream-chunk N: READSTRM bytes per read transfer (default: all in one)");
+            puts("     --image-crc: Verify with the GETIMCRC image CRC-16 (CMD_GETIMCRC)");
+            puts("     --busy-byte: WRITPAGE replies carry the busy time (WRITPAGE_BUSY)");
+            puts("  --page-delay N: Page write wait in ms without --busy-byte (default 10)");
+            puts("    --page-batch: Send all the packets of a page in a single ioctl");
+            puts("         --burst: Set the page address once for consecutive pages (CMD_PGBURST)");
+            puts("    --interleave: Upload to the devices on the same bus page by page, sending each");
+            puts("                  one its next page while the others are programming theirs");
+            puts("         --split: Send a stop between each command and its reply");
+            puts("     --retries N: Times a rejected packet is resent (default 3)");
+            puts("     bus:address: I2C bus number and Timonel TWI address, e.g. 1:11 or 1:0x0b");
+            puts("");
+            puts(TML_HOST_VERSION);
+            return EXIT_SUCCESS;
+        } else if (strcmp(arg, "--info") == 0) {
+            options.info = true;
+        } else if (strcmp(arg, "--delete") == 0) {
+            options.delete = true;
+        } else if (strcmp(arg, "--verify") == 0) {
+            options.verify = true;
+        } else if (strcmp(arg, "--dev-stats") == 0) {
+            options.dev_stats = true;
+        } else if (strcmp(arg, "--clear-stats") == 0) {
+            options.dev_stats = true;
+            options.clear_stats = true;
+        } else if (strcmp(arg, "--tune-osc") == 0) {
+            options.tune_osc = true;
+        } else if (strcmp(arg, "--exit") == 0) {
+            options.exit = true;
+        } else if (strcmp(arg, "--busy-byte") == 0) {
+            settings.busy_byte = true;
+        } else if (strcmp(arg, "--page-batch") == 0) {
+            settings.page_batch = true;
+        } else if (strcmp(arg, "--burst") == 0) {
+            settings.page_burst = true;
+        } else if (strcmp(arg, "--interleave") == 0) {
+            options.interleave = true;
+        } else if (strcmp(arg, "--split") == 0) {
+            settings.split = true;
+        } else if (strcmp(arg, "--read-stream") == 0) {
+            settings.read_stream = true;
+        } else if (strcmp(arg, "--image-crc") == 0) {
+            settings.image_crc = true;
+        } else if ((strcmp(arg, "--del-pages") == 0) && (value != NULL)) {
+            char *end;
+            options.delete_addr = (uint16_t)strtoul(value, &end, 0);
+            options.delete_pages = ((*end == ':') ? (uint16_t)strtoul(end + 1, NULL, 0) : 0);
+            if ((options.delete_pages == 0) || (options.delete_pages > 0xFF)) {
+                fprintf(stderr, "Invalid page range: %s\n", value);
+                return EXIT_FAILURE;
+            }
+            arg_pointer++;
+        } else if ((strcmp(arg, "--eeprom") == 0) && (value != NULL)) {
+            char *end;
+            options.eeprom_addr = (uint16_t)strtoul(value, &end, 0);
+            if ((*end != ':') || (*(end + 1) == '\0') || (options.eeprom_addr >= TML_EEPROM_SIZE)) {
+                fprintf(stderr, "Invalid EEPROM address and file: %s\n", value);
+                return EXIT_FAILURE;
+            }
+            options.eeprom_file = (end + 1);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--enter") == 0) && (value != NULL)) {
+            char *end;
+            unsigned long command = strtoul(value, &end, 0);
+            unsigned long address = ((*end == ':') ? strtoul(end + 1, &end, 0) : 0);
+            if ((end == value) || (*end != '\0') || (command > 0xFF) || (address > 0x7F)) {
+                fprintf(stderr, "Invalid application command: %s\n", value);
+                return EXIT_FAILURE;
+            }
+            options.enter = true;
+            options.enter_command = (uint8_t)command;
+            options.enter_addr = (uint8_t)address;
+            arg_pointer++;
+        } else if ((strcmp(arg, "--slots") == 0) && (value != NULL)) {
+            static char slot_files[2][256];
+            const char *comma = strchr(value, ',');
+            if ((comma == NULL) || (comma == value) || (*(comma + 1) == '\0') || ((comma - value) >= 256) ||
+                (strlen(comma + 1) >= 256)) {
+                fprintf(stderr, "Invalid slot images: %s\n", value);
+                return EXIT_FAILURE;
+            }
+            snprintf(slot_files[0], sizeof(slot_files[0]), "%.*s", (int)(comma - value), value);
+            snprintf(slot_files[1], sizeof(slot_files[1]), "%s", comma + 1);
+            options.slot_file[0] = slot_files[0];
+            options.slot_file[1] = slot_files[1];
+            arg_pointer++;
+        } else if ((strcmp(arg, "--upload") == 0) && (value != NULL)) {
+            options.file = value;
+            arg_pointer++;
+        } else if ((strcmp(arg, "--packet-size") == 0) && (value != NULL)) {
+            settings.packet_size = (uint8_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--read-size") == 0) && (value != NULL)) {
+            settings.read_size = (uint8_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--stream-chunk") == 0) && (value != NULL)) {
+            settings.stream_chunk = (uint16_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--page-delay") == 0) && (value != NULL)) {
+            settings.page_delay_ms = (uint16_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((strcmp(arg, "--retries") == 0) && (value != NULL)) {
+            settings.retries = (uint8_t)strtoul(value, NULL, 0);
+            arg_pointer++;
+        } else if ((arg[0] != '-') && (target_count < MAX_TARGETS)) {
+            int bus;
+            uint8_t addr;
+            if (ParseTarget(arg, &bus, &addr)) {
+                fprintf(stderr, "Invalid target: %s\n", arg);
+                return EXIT_FAILURE;
+            }
+            targets[target_count].dev.bus = bus;
+            targets[target_count++].dev.addr = addr;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (target_count == 0) {
+        puts(usage);
+        return EXIT_FAILURE;
+    }
+
+    // The settings apply to all the targets, wherever they were given
+    for (uint8_t i = 0; i < target_count; i++) {
+        int bus = targets[i].dev.bus;
+        uint8_t addr = targets[i].dev.addr;
+        targets[i].dev = settings;
+        targets[i].dev.bus = bus;
+        targets[i].dev.addr = addr;
+    }
+
+    if ((options.file != NULL) && (options.slot_file[0] != NULL)) {
+        fprintf(stderr, "--upload and --slots can't be used together\n");
+        return EXIT_FAILURE;
+    }
+    for (uint8_t slot = 0; (slot < 2) && (options.slot_file[0] != NULL); slot++) {
+        if (TmlLoadFile(options.slot_file[slot], options.slot_image[slot], &options.slot_size[slot])) {
+            fprintf(stderr, "Error loading %s\n", options.slot_file[slot]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ((options.file != NULL) && TmlLoadFile(options.file, options.image, &options.size)) {
+        fprintf(stderr, "Error loading %s\n", options.file);
+        return EXIT_FAILURE;
+    }
+
+    if ((options.eeprom_file != NULL) && TmlLoadFile(options.eeprom_file, options.eeprom_image, &options.eeprom_size)) {
+        fprintf(stderr, "Error loading %s\n", options.eeprom_file);
+        return EXIT_FAILURE;
+    }
+    if ((options.eeprom_addr + options.eeprom_size) > TML_EEPROM_SIZE) {
+        fprintf(stderr, "%s doesn't fit in the EEPROM from address 0x%03x\n", options.eeprom_file, options.eeprom_addr);
+        return EXIT_FAILURE;
+    }
+
+    // Group the targets by bus, each bus is handled by its own thread
+    for (uint8_t i = 0; i < target_count; i++) {
+        uint8_t j = 0;
+        while ((j < job_count) && (jobs[j].bus != targets[i].dev.bus)) {
+            j++;
+        }
+        if (j == job_count) {
+            jobs[job_count++].bus = targets[i].dev.bus;
+        }
+        jobs[j].targets[jobs[j].count++] = &targets[i];
+    }
+    for (uint8_t j = 0; j < job_count; j++) {
+        if (pthread_create(&jobs[j].thread, NULL, RunBus, &jobs[j])) {
+            fprintf(stderr, "Error starting the bus %d thread\n", jobs[j].bus);
+            return EXIT_FAILURE;
+        }
+    }
+    for (uint8_t j = 0; j < job_count; j++) {
+        pthread_join(jobs[j].thread, NULL);
+    }
+
+    // Report
+    int failures = 0;
+    for (uint8_t i = 0; i < target_count; i++) {
+        if (options.info && (targets[i].dev.info.signature != 0)) {
+            PrintInfo(&targets[i]);
+        }
+        PrintStats(&targets[i]);
+        if (targets[i].result != TML_OK) {
+            failures++;
+        }
+    }
+    return ((failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+// Bus thread: run all the targets on this bus one after the other, or interleaving their uploads
+static void *RunBus(void *arg) {
+    BusJob *job = (BusJob *)arg;
+    TmlDevice bus_dev;
+    TmlDeviceInit(&bus_dev, job->bus, 0);
+    int result = TmlOpen(&bus_dev);
+    if ((result == TML_OK) && options.interleave && (options.file != NULL) && (job->count > 1)) {
+        RunInterleaved(job, bus_dev.fd);
+    } else {
+        for (uint8_t i = 0; i < job->count; i++) {
+            if (result != TML_OK) {
+                job->targets[i]->result = result;
+                job->targets[i]->failed_phase = "open";
+                continue;
+            }
+            RunTarget(job->targets[i], bus_dev.fd);
+        }
+    }
+    TmlClose(&bus_dev);
+    return NULL;
+}
+
+// Run the requested phases on one device, stopping at the first failure
+static void RunTarget(Target *target, int fd) {
+    RunSetup(target, fd);
+    if ((target->result == TML_OK) && (options.file != NULL)) {
+        target->failed_phase = "upload";
+        target->result = TmlUpload(&target->dev, options.image, options.size, target->erased);
+    }
+    RunFinish(target);
+}
+
+// Run the phases before and after the upload on one device after the other, and
+// upload the application to all of them at once, one page at a time on each
+static void RunInterleaved(BusJob *job, int fd) {
+    TmlDevice *devs[MAX_TARGETS];
+    TmlUploadJob *uploads[MAX_TARGETS];
+    Target *uploading[MAX_TARGETS];
+    int results[MAX_TARGETS];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < job->count; i++) {
+        RunSetup(job->targets[i], fd);
+    }
+    for (uint8_t i = 0; i < job->count; i++) {
+        Target *target = job->targets[i];
+        if (target->result == TML_OK) {
+            target->failed_phase = "upload";
+            target->result = TmlUploadBegin(&target->dev, &target->upload, options.image, options.size, target->erased);
+        }
+        if (target->result == TML_OK) {
+            devs[count] = &target->dev;
+            uploads[count] = &target->upload;
+            uploading[count++] = target;
+        }
+    }
+    TmlUploadInterleaved(devs, uploads, count, results);
+    for (uint8_t i = 0; i < count; i++) {
+        uploading[i]->result = results[i];
+    }
+    for (uint8_t i = 0; i < job->count; i++) {
+        RunFinish(job->targets[i]);
+    }
+}
+
+// Run the phases before the upload: enter, init, tune and delete
+static void RunSetup(Target *target, int fd) {
+    TmlDevice *dev = &target->dev;
+    dev->fd = fd;
+    target->result = TML_OK;
+    if (options.enter) {
+        target->failed_phase = "enter";
+        target->result = TmlEnterBootloader(dev, ((options.enter_addr != 0) ? options.enter_addr : dev->addr),
+                                            options.enter_command);
+    }
+    if (target->result == TML_OK) {
+        target->failed_phase = "init";
+        target->result = TmlInitialize(dev);
+    }
+    if ((target->result == TML_OK) && options.tune_osc) {
+        target->failed_phase = "tune";
+        target->result = TmlCalibrateOsc(dev, &target->osccal);
+    }
+    // With erase-on-write, each page is erased as it's written, there is no need to delete the application first
+    target->erased = (options.delete && !((dev->info.ext_features >> TML_EF_FORCE_ERASE_PG) & true));
+    if ((target->result == TML_OK) && target->erased) {
+        target->failed_phase = "delete";
+        target->result = TmlDeleteFlash(dev);
+    }
+    if ((target->result == TML_OK) && (options.delete_pages > 0)) {
+        target->failed_phase = "delete pages";
+        target->result = TmlDeletePages(dev, options.delete_addr, (uint8_t)options.delete_pages);
+    }
+}
+
+// Run the phases after the upload: verify, slots, EEPROM, statistics and exit
+static void RunFinish(Target *target) {
+    TmlDevice *dev = &target->dev;
+    if ((target->result == TML_OK) && (options.file != NULL) && options.verify) {
+        target->failed_phase = "verify";
+        target->result = TmlVerify(dev, options.image, options.size);
+    }
+    if ((target->result == TML_OK) && (options.slot_file[0] != NULL)) {
+        // The running application is kept in the active slot until the switch
+        uint8_t slot = ((TmlActiveSlot(dev) == 0) ? 1 : 0);
+        target->failed_phase = "slot upload";
+        target->result = TmlSlotUpload(dev, slot, options.slot_image[slot], options.slot_size[slot]);
+        if ((target->result == TML_OK) && options.verify) {
+            target->failed_phase = "slot verify";
+            target->result = TmlSlotVerify(dev, slot, options.slot_image[slot], options.slot_size[slot]);
+        }
+        if (target->result == TML_OK) {
+            target->failed_phase = "switch";
+            target->result = TmlSwitchSlot(dev, slot);
+        }
+    }
+    if ((target->result == TML_OK) && (options.eeprom_file != NULL)) {
+        target->failed_phase = "eeprom";
+        target->result = TmlEepromUpload(dev, options.eeprom_addr, options.eeprom_image, options.eeprom_size);
+    }
+    if ((target->result == TML_OK) && (options.eeprom_file != NULL) && options.verify) {
+        target->failed_phase = "eeprom verify";
+        target->result = TmlEepromVerify(dev, options.eeprom_addr, options.eeprom_image, options.eeprom_size);
+    }
+    if ((target->result == TML_OK) && options.dev_stats) {
+        target->failed_phase = "statistics";
+        target->result = TmlReadStats(dev, &target->dev_stats, options.clear_stats);
+        target->has_dev_stats = (target->result == TML_OK);
+    }
+    if ((target->result == TML_OK) && options.exit) {
+        target->failed_phase = "exit";
+        target->result = TmlExit(dev);
+    }
+    dev->fd = -1;  // The bus file descriptor is closed by the bus thread
+}
+
+// Parse a "bus:address" target
+static int ParseTarget(const char *arg, int *bus, uint8_t *addr) {
+    char *end;
+    long bus_number = strtol(arg, &end, 10);
+    if ((end == arg) || (*end != ':') || (bus_number < 0)) {
+        return 1;
+    }
+    const char *addr_text = (end + 1);
+    unsigned long address = strtoul(addr_text, &end, 0);
+    if ((end == addr_text) || (*end != '\0') || (address < 8) || (address > 0x77)) {
+        return 1;
+    }
+    *bus = (int)bus_number;
+    *addr = (uint8_t)address;
+    return 0;
+}
+
+static void PrintInfo(const Target *target) {
+    const TmlInfo *info = &target->dev.info;
+    printf("[%d:0x%02x] Timonel %c v%d.%d, features 0x%02x, ext features 0x%02x, start 0x%04x, trampoline 0x%04x, low fuse 0x%02x, osccal 0x%02x\n",
+           target->dev.bus, target->dev.addr, info->signature, info->version_major, info->version_minor,
+           info->features, info->ext_features, info->start_addr, info->trampoline, info->low_fuse, info->osccal);
+}
+
+static void PrintStats(const Target *target) {
+    const TmlStats *stats = &target->dev.stats;
+    printf("[%d:0x%02x] %s", target->dev.bus, target->dev.addr, (target->result == TML_OK) ? "OK" : "FAILED");
+    if (target->result != TML_OK) {
+        printf(" at %s: %s", target->failed_phase, TmlStrError(target->result));
+    }
+    printf("\n    ");
+    if (options.enter) {
+        printf("enter %.1f ms, ", stats->enter_ms);
+    }
+    printf("init %.1f ms", stats->init_ms);
+    if (options.tune_osc) {
+        printf(", tune %.1f ms (osccal 0x%02x)", stats->tune_ms, target->osccal);
+    }
+    if (options.delete || (options.delete_pages > 0)) {
+        printf(", delete %.1f ms", stats->delete_ms);
+    }
+    if ((options.file != NULL) || (options.slot_file[0] != NULL)) {
+        double rate = ((stats->upload_ms > 0) ? (stats->bytes / stats->upload_ms) : 0);
+        printf(", upload %.1f ms (page write waits %.1f ms, %u bytes, %.2f KB/s)", stats->upload_ms, stats->wait_ms,
+               stats->bytes, rate * 1000.0 / 1024.0);
+    }
+    if (options.verify) {
+        printf(", verify %.1f ms", stats->verify_ms);
+    }
+    if (options.eeprom_file != NULL) {
+        printf(", eeprom %.1f ms (%u bytes written)", stats->eeprom_ms, stats->eeprom_bytes);
+    }
+    if (options.slot_file[0] != NULL) {
+        printf(", switch %.1f ms", stats->switch_ms);
+    }
+    if (options.exit) {
+        printf(", exit %.1f ms", stats->exit_ms);
+    }
+    printf("\n    %u pages, %u packets, %u retries, %u transactions\n", stats->pages, stats->packets, stats->retries,
+           stats->transactions);
+    if (target->has_dev_stats) {
+        PrintDevStats(target);
+    }
+}
+
+static void PrintDevStats(const Target *target) {
+    const TmlDevStats *dev_stats = &target->dev_stats;
+    printf("    device: %u restarts (reset flags 0x%02x), %u packets rejected, %u deletes, %u general calls, %u pages written, slow-ops ",
+           dev_stats->restarts, dev_stats->reset_flags, dev_stats->rejected, dev_stats->del_flash, dev_stats->broadcasts,
+           dev_stats->pages);
+    // Timonel runs at 16 MHz with the PLL clock source and at 8 MHz with the RC oscillator (sped up for TWI)
+    uint8_t clock_source = (target->dev.info.low_fuse & 0x0F);
+    double clock_mhz = ((clock_source == 0x01) ? 16.0 : ((clock_source == 0x02) ? 8.0 : 0));
+    if (clock_mhz > 0) {
+        printf("%.1f ms\n", (dev_stats->slow_ticks * (double)TML_STATS_TICK_CLKS / (clock_mhz * 1000.0)));
+    } else {
+        printf("%lu x %u clock cycles\n", (unsigned long)dev_stats->slow_ticks, TML_STATS_TICK_CLKS);
+    }
+}
@@ -0,0 +1,1533 @@
+/*
+ *  Timonel - TWI Bootloader for TinyX5 MCUs
+ *  Author: Gustavo Casanova
+ *  ...........................................
+ *  File: tml-twim.c (Linux host TWI master library)
+ *  ...........................................
+ *  Version: 0.1 / 2020-06-06
+ *  gustavo.casanova@nicebots.com
+ *  ...........................................
+ *  This library talks to Timonel through the
+ *  Linux "i2c-dev" interface. Each command is
+ *  sent with a single I2C_RDWR ioctl: a write
+ *  message followed by a read message with a
+ *  repeated start, while Timonel stretches the
+ *  clock until its reply is ready.
+ */
+
+#include "tml-twim.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_BATCH_PACKETS (I2C_RDWR_IOCTL_MAX_MSGS / 2) /* Write + read messages per packet */
+#define RESTART_POLL_MS 20                              /* GETTMNLV polling interval after DELFLASH */
+#define RESTART_TIMEOUT_MS 3000                         /* Maximum time to wait for the device restart */
+#define IMCRC_POLL_MS 5                                 /* GETIMCRC polling interval while the CRC is calculated */
+#define IMCRC_TIMEOUT_MS 2000                           /* Maximum time to wait for the GETIMCRC result */
+#define EEPROM_WRITE_US 3400                            /* EEPROM byte erase and write time */
+#define OSC_TUNE_STEP 2                                 /* OSCCAL increment between TUNEOSCC trial settings */
+#define OSC_TUNE_MARGIN 4                               /* OSCCAL steps kept below the fastest error-free setting */
+#define OSC_TUNE_PROBES 16                              /* GETTMNLV transfers timed at each trial setting */
+#define OSC_REVERT_POLL_MS 20                           /* TUNEOSCC polling interval after a failed trial setting */
+#define OSC_REVERT_TIMEOUT_MS 1000                      /* Maximum time to wait for Timonel to answer at the safe setting */
+
+// Internal prototypes
+static int TwiCommand(TmlDevice *dev, const uint8_t *command, uint8_t command_len, uint8_t *reply, uint16_t reply_len);
+static int TwiRead(TmlDevice *dev, uint8_t *data, uint16_t data_len);
+static int WritePage(TmlDevice *dev, const uint8_t *page_data, uint16_t ix, uint8_t *busy_ms);
+static int WritePageBatch(TmlDevice *dev, const uint8_t *page_data, uint8_t *busy_ms, uint16_t *resume_ix);
+static int SendPage(TmlDevice *dev, uint16_t page_addr, const uint8_t *page_data, uint16_t *burst_next,
+                    uint8_t *busy_ms);
+static uint8_t BuildPacket(TmlDevice *dev, const uint8_t *data, uint8_t *command);
+static int CheckPacketReply(TmlDevice *dev, const uint8_t *command, const uint8_t *reply, uint8_t *busy_ms);
+static uint16_t PrepareImage(TmlDevice *dev, const uint8_t *image, uint16_t size, uint8_t *flash);
+static uint16_t AppLimit(TmlDevice *dev);
+static bool IsBlankPage(const uint8_t *page_data);
+static int CheckSlotImage(TmlDevice *dev, uint8_t slot, const uint8_t *image, uint16_t size);
+static int NextPageAddr(TmlDevice *dev, uint16_t page_addr, uint16_t last_page, uint16_t *burst_next);
+static int ProbeOscillator(TmlDevice *dev, double *probe_ms);
+static int ParseIntelHex(FILE *input, const char *path, uint8_t *image, uint16_t *size);
+static double NowMs(void);
+static void SleepMs(uint32_t ms);
+static void SleepUs(uint32_t us);
+static void WaitReady(TmlDevice *dev, double ready_ms);
+
+/* _____________________
+  |                     |
+  |    TmlDeviceInit    |
+  |_____________________|
+*/
+void TmlDeviceInit(TmlDevice *dev, int bus, uint8_t addr) {
+    memset(dev, 0, sizeof(TmlDevice));
+    dev->fd = -1;
+    dev->bus = bus;
+    dev->addr = addr;
+    dev->packet_size = 32;  // Bootloader default MST_PACKET_SIZE
+    dev->read_size = 32;    // Bootloader default SLV_PACKET_SIZE
+    dev->reply_delay_us = 1000;
+    dev->page_delay_ms = 10;
+    dev->retries = 3;
+}
+
+/* _____________________
+  |                     |
+  |       TmlOpen       |
+  |_____________________|
+*/
+int TmlOpen(TmlDevice *dev) {
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/i2c-%d", dev->bus);
+    dev->fd = open(path, O_RDWR);
+    if (dev->fd < 0) {
+        return TML_ERR_IO;
+    }
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |      TmlClose       |
+  |_____________________|
+*/
+void TmlClose(TmlDevice *dev) {
+    if (dev->fd >= 0) {
+        close(dev->fd);
+        dev->fd = -1;
+    }
+}
+
+/* _____________________
+  |                     |
+  |    TmlGetVersion    |
+  |_____________________|
+*/
+int TmlGetVersion(TmlDevice *dev) {
+    const uint8_t command[] = {GETTMNLV};
+    uint8_t reply[TML_GETTMNLV_RPLYLN];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != ACKTMNLV) {
+        return TML_ERR_ACK;
+    }
+    dev->info.signature = reply[1];
+    dev->info.version_major = reply[2];
+    dev->info.version_minor = reply[3];
+    dev->info.features = reply[4];
+    dev->info.ext_features = reply[5];
+    dev->info.start_addr = ((reply[6] << 8) | reply[7]);
+    dev->info.trampoline = ((reply[8] << 8) | reply[9]);
+    dev->info.low_fuse = reply[10];
+    dev->info.osccal = reply[11];
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |     TmlInitSoft     |
+  |_____________________|
+*/
+int TmlInitSoft(TmlDevice *dev) {
+    const uint8_t command[] = {INITSOFT};
+    uint8_t reply[1];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    if (result != TML_OK) {
+        return result;
+    }
+    return ((reply[0] == ACKINITS) ? TML_OK : TML_ERR_ACK);
+}
+
+/* _____________________
+  |                     |
+  | TmlEnterBootloader  |
+  |_____________________|
+*/
+int TmlEnterBootloader(TmlDevice *dev, uint8_t app_addr, uint8_t app_command) {
+    double start = NowMs();
+    // Ask the running application to jump to Timonel (APP_WARM_ENTRY) or to reset, it doesn't reply
+    struct i2c_msg msg = {.addr = app_addr, .flags = 0, .len = 1, .buf = &app_command};
+    struct i2c_rdwr_ioctl_data transfer = {.msgs = &msg, .nmsgs = 1};
+    if (ioctl(dev->fd, I2C_RDWR, &transfer) < 0) {
+        return TML_ERR_IO;
+    }
+    dev->stats.transactions++;
+    int result = TML_ERR_TIMEOUT;
+    for (uint16_t waited = 0; waited < RESTART_TIMEOUT_MS; waited += RESTART_POLL_MS) {
+        SleepMs(RESTART_POLL_MS);
+        if (TmlGetVersion(dev) == TML_OK) {
+            result = TML_OK;
+            break;
+        }
+    }
+    dev->stats.enter_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |    TmlInitialize    |
+  |_____________________|
+*/
+int TmlInitialize(TmlDevice *dev) {
+    double start = NowMs();
+    int result = TmlGetVersion(dev);
+    if ((result == TML_OK) && ((dev->info.features >> TML_FT_TWO_STEP_INIT) & true)) {
+        result = TmlInitSoft(dev);
+    }
+    dev->stats.init_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |   TmlDeleteFlash    |
+  |_____________________|
+*/
+int TmlDeleteFlash(TmlDevice *dev) {
+    double start = NowMs();
+    const uint8_t command[] = {DELFLASH};
+    uint8_t reply[1];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != ACKDELFL) {
+        return TML_ERR_ACK;
+    }
+    // Timonel erases all the application pages and then restarts, wait for it and initialize it again
+    SleepMs(((dev->info.start_addr / TML_SPM_PAGESIZE) * 5) + 50);
+    result = TML_ERR_TIMEOUT;
+    for (uint16_t waited = 0; waited < RESTART_TIMEOUT_MS; waited += RESTART_POLL_MS) {
+        if (TmlGetVersion(dev) == TML_OK) {
+            result = TML_OK;
+            break;
+        }
+        SleepMs(RESTART_POLL_MS);
+    }
+    if ((result == TML_OK) && ((dev->info.features >> TML_FT_TWO_STEP_INIT) & true)) {
+        result = TmlInitSoft(dev);
+    }
+    dev->stats.delete_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |   TmlDeletePages    |
+  |_____________________|
+*/
+int TmlDeletePages(TmlDevice *dev, uint16_t page_addr, uint8_t page_count) {
+    double start = NowMs();
+    const uint8_t command[] = {DELPAGES, (uint8_t)(page_addr >> 8), (uint8_t)(page_addr & 0xFF), page_count};
+    uint8_t reply[2];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != ACKDELPG) {
+        return TML_ERR_ACK;
+    }
+    // Timonel erases the pages without restarting, but it doesn't answer meanwhile. Two
+    // extra page writes may be needed to keep the reset vector and the trampoline.
+    SleepMs((reply[1] + 2) * 5);
+    result = TML_ERR_TIMEOUT;
+    for (uint16_t waited = 0; waited < RESTART_TIMEOUT_MS; waited += RESTART_POLL_MS) {
+        if (TmlGetVersion(dev) == TML_OK) {
+            result = TML_OK;
+            break;
+        }
+        SleepMs(RESTART_POLL_MS);
+    }
+    if ((result == TML_OK) && (reply[1] != page_count)) {
+        result = TML_ERR_SIZE;  // Part of the range is outside the application area
+    }
+    dev->stats.delete_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |   TmlSetPageAddr    |
+  |_____________________|
+*/
+int TmlSetPageAddr(TmlDevice *dev, uint16_t page_addr) {
+    const uint8_t command[] = {STPGADDR, (uint8_t)(page_addr >> 8), (uint8_t)(page_addr & 0xFF)};
+    uint8_t reply[2];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != AKPGADDR) {
+        return TML_ERR_ACK;
+    }
+    return ((reply[1] == (uint8_t)(command[1] + command[2])) ? TML_OK : TML_ERR_CHECKSUM);
+}
+
+/* _____________________
+  |                     |
+  |   TmlSetPageBurst   |
+  |_____________________|
+*/
+int TmlSetPageBurst(TmlDevice *dev, uint16_t page_addr, uint8_t page_count) {
+    const uint8_t command[] = {STPGBRST, (uint8_t)(page_addr >> 8), (uint8_t)(page_addr & 0xFF), page_count};
+    uint8_t reply[2];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != AKPGBRST) {
+        return TML_ERR_ACK;
+    }
+    return ((reply[1] == (uint8_t)(command[1] + command[2] + command[3])) ? TML_OK : TML_ERR_CHECKSUM);
+}
+
+/* _____________________
+  |                     |
+  |   TmlWritePacket    |
+  |_____________________|
+*/
+int TmlWritePacket(TmlDevice *dev, const uint8_t *data, uint8_t *busy_ms) {
+    uint8_t command[1 + TML_MAX_PACKET_SIZE + 2];
+    uint8_t reply[4];
+    uint8_t command_len = BuildPacket(dev, data, command);
+    uint8_t reply_len = (command_len - dev->packet_size + (dev->busy_byte ? 1 : 0));
+    int result = TwiCommand(dev, command, command_len, reply, reply_len);
+    if (result != TML_OK) {
+        return result;
+    }
+    dev->stats.packets++;
+    return CheckPacketReply(dev, command, reply, busy_ms);
+}
+
+/* _____________________
+  |                     |
+  |    TmlReadFlash     |
+  |_____________________|
+*/
+int TmlReadFlash(TmlDevice *dev, uint16_t addr, uint8_t *data, uint8_t size) {
+    bool use_crc16 = ((dev->info.ext_features >> TML_EF_USE_CRC16) & true);
+    const uint8_t command[] = {READFLSH, (uint8_t)(addr >> 8), (uint8_t)(addr & 0xFF), size};
+    uint8_t reply[1 + TML_MAX_PACKET_SIZE + 2];
+    uint8_t reply_len = (1 + size + (use_crc16 ? 2 : 1));
+    if (size > TML_MAX_PACKET_SIZE) {
+        return TML_ERR_SIZE;
+    }
+    int result = TwiCommand(dev, command, sizeof(command), reply, reply_len);
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != ACKRDFSH) {
+        return TML_ERR_ACK;
+    }
+    if (use_crc16) {
+        uint16_t crc = TmlCrc16(TmlCrc16(0x0000, command[1]), command[2]);
+        for (uint8_t i = 1; i <= size; i++) {
+            crc = TmlCrc16(crc, reply[i]);
+        }
+        if ((reply[reply_len - 2] != (uint8_t)(crc >> 8)) || (reply[reply_len - 1] != (uint8_t)(crc & 0xFF))) {
+            return TML_ERR_CHECKSUM;
+        }
+    } else {
+        uint8_t checksum = (uint8_t)(command[1] + command[2]);
+        for (uint8_t i = 1; i <= size; i++) {
+            checksum += reply[i];
+        }
+        if (reply[reply_len - 1] != checksum) {
+            return TML_ERR_CHECKSUM;
+        }
+    }
+    memcpy(data, &reply[1], size);
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |    TmlReadStream    |
+  |_____________________|
+*/
+int TmlReadStream(TmlDevice *dev, uint16_t addr, uint8_t *data, uint16_t size) {
+    const uint8_t command[] = {READSTRM, (uint8_t)(addr >> 8), (uint8_t)(addr & 0xFF), (uint8_t)(size >> 8), (uint8_t)(size & 0xFF)};
+    uint8_t stream[1 + TML_FLASH_SIZE + 2];  // Acknowledge + data + CRC-16
+    uint16_t stream_len = (1 + size + 2);
+    uint16_t chunk = (((dev->stream_chunk == 0) || (dev->stream_chunk > stream_len)) ? stream_len : dev->stream_chunk);
+    if (size > TML_FLASH_SIZE) {
+        return TML_ERR_SIZE;
+    }
+    // The first chunk is read right after the command, then the rest of the stream is read without commands
+    int result = TwiCommand(dev, command, sizeof(command), stream, chunk);
+    for (uint16_t ix = chunk; (ix < stream_len) && (result == TML_OK); ix += chunk) {
+        if (chunk > (stream_len - ix)) {
+            chunk = (stream_len - ix);
+        }
+        result = TwiRead(dev, &stream[ix], chunk);
+    }
+    if (result != TML_OK) {
+        return result;
+    }
+    if (stream[0] != ACKRDSTM) {
+        return TML_ERR_ACK;
+    }
+    uint16_t crc = 0x0000;
+    for (uint16_t i = 1; i <= size; i++) {
+        crc = TmlCrc16(crc, stream[i]);
+    }
+    if ((stream[stream_len - 2] != (uint8_t)(crc >> 8)) || (stream[stream_len - 1] != (uint8_t)(crc & 0xFF))) {
+        return TML_ERR_CHECKSUM;
+    }
+    memcpy(data, &stream[1], size);
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |   TmlGetImageCrc    |
+  |_____________________|
+*/
+int TmlGetImageCrc(TmlDevice *dev, uint16_t addr, uint16_t length, uint16_t *crc) {
+    const uint8_t command[] = {GETIMCRC, (uint8_t)(addr >> 8), (uint8_t)(addr & 0xFF), (uint8_t)(length >> 8), (uint8_t)(length & 0xFF)};
+    uint8_t reply[4];
+    // The first request starts the calculation on the device, the same request
+    // is repeated until it replies with the result instead of IMCRC_BUSY.
+    for (uint16_t waited = 0; waited < IMCRC_TIMEOUT_MS; waited += IMCRC_POLL_MS) {
+        int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+        if (result != TML_OK) {
+            return result;
+        }
+        if (reply[0] != ACKIMCRC) {
+            return TML_ERR_ACK;
+        }
+        if (reply[1] == IMCRC_READY) {
+            *crc = (uint16_t)((reply[2] << 8) | reply[3]);
+            return TML_OK;
+        }
+        if (reply[1] != IMCRC_BUSY) {
+            return TML_ERR_SIZE;  // The range is outside the application area
+        }
+        SleepMs(IMCRC_POLL_MS);
+    }
+    return TML_ERR_TIMEOUT;
+}
+
+/* _____________________
+  |                     |
+  |   TmlWriteEeprom    |
+  |_____________________|
+*/
+int TmlWriteEeprom(TmlDevice *dev, uint16_t addr, const uint8_t *data, uint8_t size) {
+    uint8_t checksum_len = (((dev->info.ext_features >> TML_EF_USE_CRC16) & true) ? 2 : 1);
+    uint8_t command[4 + TML_MAX_PACKET_SIZE + 2];
+    uint8_t reply[1 + 1 + 2];
+    if ((size == 0) || (size > dev->packet_size) || (size > TML_MAX_PACKET_SIZE)) {
+        return TML_ERR_SIZE;
+    }
+    uint8_t command_len = (4 + size);
+    command[0] = WRITEEPB;
+    command[1] = (uint8_t)(addr >> 8);
+    command[2] = (uint8_t)(addr & 0xFF);
+    command[3] = size;
+    memcpy(&command[4], data, size);
+    // The checksum covers the address, the length and the data bytes
+    if (checksum_len == 2) {
+        uint16_t crc = 0x0000;
+        for (uint8_t i = 1; i < command_len; i++) {
+            crc = TmlCrc16(crc, command[i]);
+        }
+        command[command_len++] = (uint8_t)(crc >> 8);
+        command[command_len++] = (uint8_t)(crc & 0xFF);
+    } else {
+        uint8_t checksum = 0;
+        for (uint8_t i = 1; i < command_len; i++) {
+            checksum += command[i];
+        }
+        command[command_len++] = checksum;
+    }
+    int result = TwiCommand(dev, command, command_len, reply, (2 + checksum_len));
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != ACKWTEPB) {
+        return TML_ERR_ACK;
+    }
+    if (memcmp(&reply[2], &command[4 + size], checksum_len)) {
+        return TML_ERR_REJECTED;  // Timonel doesn't write a block whose checksum doesn't match
+    }
+    // The changed bytes are written after the reply, Timonel doesn't answer meanwhile
+    dev->stats.eeprom_bytes += reply[1];
+    SleepMs(((reply[1] * EEPROM_WRITE_US) + 999) / 1000);
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |    TmlReadEeprom    |
+  |_____________________|
+*/
+int TmlReadEeprom(TmlDevice *dev, uint16_t addr, uint8_t *data, uint8_t size) {
+    bool use_crc16 = ((dev->info.ext_features >> TML_EF_USE_CRC16) & true);
+    const uint8_t command[] = {READEEPB, (uint8_t)(addr >> 8), (uint8_t)(addr & 0xFF), size};
+    uint8_t reply[1 + TML_MAX_PACKET_SIZE + 2];
+    uint8_t reply_len = (1 + size + (use_crc16 ? 2 : 1));
+    if ((size == 0) || (size > dev->read_size) || (size > TML_MAX_PACKET_SIZE)) {
+        return TML_ERR_SIZE;
+    }
+    int result = TwiCommand(dev, command, sizeof(command), reply, reply_len);
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != ACKRDEPB) {
+        return TML_ERR_ACK;
+    }
+    // Same checksum as READFLSH: address MSB, LSB and the data bytes
+    if (use_crc16) {
+        uint16_t crc = TmlCrc16(TmlCrc16(0x0000, command[1]), command[2]);
+        for (uint8_t i = 1; i <= size; i++) {
+            crc = TmlCrc16(crc, reply[i]);
+        }
+        if ((reply[reply_len - 2] != (uint8_t)(crc >> 8)) || (reply[reply_len - 1] != (uint8_t)(crc & 0xFF))) {
+            return TML_ERR_CHECKSUM;
+        }
+    } else {
+        uint8_t checksum = (uint8_t)(command[1] + command[2]);
+        for (uint8_t i = 1; i <= size; i++) {
+            checksum += reply[i];
+        }
+        if (reply[reply_len - 1] != checksum) {
+            return TML_ERR_CHECKSUM;
+        }
+    }
+    memcpy(data, &reply[1], size);
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |       TmlExit       |
+  |_____________________|
+*/
+int TmlExit(TmlDevice *dev) {
+    double start = NowMs();
+    const uint8_t command[] = {EXITTMNL};
+    uint8_t reply[1];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    dev->stats.exit_ms += (NowMs() - start);
+    if (result != TML_OK) {
+        return result;
+    }
+    return ((reply[0] == ACKEXITT) ? TML_OK : TML_ERR_ACK);
+}
+
+/* _____________________
+  |                     |
+  |    TmlSwitchSlot    |
+  |_____________________|
+*/
+int TmlSwitchSlot(TmlDevice *dev, uint8_t slot) {
+    double start = NowMs();
+    const uint8_t command[] = {SWITSLOT, slot};
+    uint8_t reply[2];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    if (result != TML_OK) {
+        return result;
+    }
+    if ((reply[0] != ACKSWSLT) || (reply[1] != slot)) {
+        return TML_ERR_ACK;  // Unknown command, or the slot is empty
+    }
+    // Timonel writes the trampoline page, and page 0 the first time, without answering meanwhile
+    SleepMs(dev->page_delay_ms * 2);
+    result = TML_ERR_TIMEOUT;
+    for (uint16_t waited = 0; waited < RESTART_TIMEOUT_MS; waited += RESTART_POLL_MS) {
+        if (TmlGetVersion(dev) == TML_OK) {
+            result = TML_OK;
+            break;
+        }
+        SleepMs(RESTART_POLL_MS);
+    }
+    if ((result == TML_OK) && (TmlActiveSlot(dev) != slot)) {
+        result = TML_ERR_VERIFY;  // The trampoline doesn't point to the slot
+    }
+    dev->stats.switch_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |     TmlReadStats    |
+  |_____________________|
+*/
+int TmlReadStats(TmlDevice *dev, TmlDevStats *dev_stats, bool clear) {
+    const uint8_t command[] = {READSTAT, (clear ? 1 : 0)};
+    uint8_t reply[TML_READSTAT_RPLYLN];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != ACKRDSTA) {
+        return TML_ERR_ACK;
+    }
+    // The features bytes and OSCCAL are the same ones that GETTMNLV returns
+    if ((reply[1] != dev->info.features) || (reply[2] != dev->info.ext_features)) {
+        return TML_ERR_ACK;
+    }
+    dev_stats->reset_flags = reply[4];
+    dev_stats->restarts = ((reply[5] << 8) | reply[6]);
+    dev_stats->rejected = ((reply[7] << 8) | reply[8]);
+    dev_stats->del_flash = ((reply[9] << 8) | reply[10]);
+    dev_stats->broadcasts = ((reply[11] << 8) | reply[12]);
+    dev_stats->pages = ((reply[13] << 8) | reply[14]);
+    dev_stats->slow_ticks = (((uint32_t)reply[15] << 24) | ((uint32_t)reply[16] << 16) | (reply[17] << 8) | reply[18]);
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |      TmlTuneOsc     |
+  |_____________________|
+*/
+int TmlTuneOsc(TmlDevice *dev, uint8_t osccal, uint8_t *target, uint8_t *safe) {
+    const uint8_t command[] = {TUNEOSCC, osccal};
+    uint8_t reply[TML_TUNEOSCC_RPLYLN];
+    int result = TwiCommand(dev, command, sizeof(command), reply, sizeof(reply));
+    if (result != TML_OK) {
+        return result;
+    }
+    if (reply[0] != ACKTNOSC) {
+        return TML_ERR_ACK;
+    }
+    // The test pattern and the checksum catch the bit errors of a clock running too fast
+    uint8_t checksum = 0;
+    for (uint8_t i = 1; i < (TML_TUNEOSCC_RPLYLN - 1); i++) {
+        checksum += reply[i];
+    }
+    if ((reply[3] != 0x55) || (reply[4] != 0xAA) || (reply[5] != 0x00) || (reply[6] != 0xFF) ||
+        (reply[7] != checksum)) {
+        return TML_ERR_CHECKSUM;
+    }
+    *target = reply[1];
+    *safe = reply[2];
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |      TmlUpload      |
+  |_____________________|
+*/
+int TmlUpload(TmlDevice *dev, const uint8_t *image, uint16_t size, bool erased) {
+    TmlUploadJob job;
+    int result = TmlUploadBegin(dev, &job, image, size, erased);
+    while ((result == TML_OK) && !job.done) {
+        // The device can't answer while it's programming the page, wait for it
+        WaitReady(dev, job.ready_ms);
+        result = TmlUploadPage(dev, &job);
+    }
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |    TmlUploadBegin   |
+  |_____________________|
+*/
+int TmlUploadBegin(TmlDevice *dev, TmlUploadJob *job, const uint8_t *image, uint16_t size, bool erased) {
+    bool auto_page_addr = ((dev->info.features >> TML_FT_AUTO_PAGE_ADDR) & true);
+    bool cmd_setpgaddr = ((dev->info.features >> TML_FT_CMD_SETPGADDR) & true);
+    if ((dev->packet_size == 0) || (dev->packet_size > TML_SPM_PAGESIZE) || (TML_SPM_PAGESIZE % dev->packet_size)) {
+        return TML_ERR_SIZE;
+    }
+    if ((size == 0) || (size > AppLimit(dev))) {
+        return TML_ERR_SIZE;
+    }
+    job->end = PrepareImage(dev, image, size, job->flash);
+    if (auto_page_addr) {
+        // Timonel modifies the reset vector and writes the trampoline by itself, send the image as is
+        memcpy(job->flash, image, 2);
+    } else if (!cmd_setpgaddr) {
+        return TML_ERR_FEATURE;
+    }
+    job->size = size;
+    job->tpl_page = (dev->info.start_addr - TML_SPM_PAGESIZE);
+    job->burst_next = 0xFFFF;
+    job->page_addr = 0;
+    job->erased = erased;
+    job->done = false;
+    job->start_ms = NowMs();
+    job->ready_ms = job->start_ms;
+    return TML_OK;
+}
+
+/* _____________________
+  |                     |
+  |    TmlUploadPage    |
+  |_____________________|
+*/
+int TmlUploadPage(TmlDevice *dev, TmlUploadJob *job) {
+    bool auto_page_addr = ((dev->info.features >> TML_FT_AUTO_PAGE_ADDR) & true);
+    bool cmd_setpgaddr = ((dev->info.features >> TML_FT_CMD_SETPGADDR) & true);
+    // Look for the next page to write
+    for (; job->page_addr < TML_FLASH_SIZE; job->page_addr += TML_SPM_PAGESIZE) {
+        if (job->page_addr >= job->end) {
+            // Without automatic page addressing, the master also has to write the trampoline page
+            if (auto_page_addr || (job->page_addr > job->tpl_page)) {
+                job->page_addr = TML_FLASH_SIZE;
+                break;
+            }
+            if (job->page_addr < job->tpl_page) {
+                job->page_addr = job->tpl_page;
+            }
+        }
+        // Blank pages can be skipped only when the application was deleted before
+        if (!(cmd_setpgaddr && job->erased && (job->page_addr != 0) && (job->page_addr != job->tpl_page) &&
+              IsBlankPage(&job->flash[job->page_addr]))) {
+            break;
+        }
+    }
+    int result = TML_OK;
+    if (job->page_addr < TML_FLASH_SIZE) {
+        if (cmd_setpgaddr) {
+            result = NextPageAddr(dev, (uint16_t)job->page_addr, job->tpl_page, &job->burst_next);
+        }
+        uint8_t busy_ms = 0;
+        if (result == TML_OK) {
+            result = SendPage(dev, (uint16_t)job->page_addr, &job->flash[job->page_addr], &job->burst_next, &busy_ms);
+        }
+        if (result == TML_OK) {
+            dev->stats.pages++;
+            if (!dev->busy_byte) {
+                busy_ms = dev->page_delay_ms;
+                if (auto_page_addr && (job->page_addr == 0)) {
+                    busy_ms *= 2;  // The trampoline page is also written
+                }
+            }
+            job->ready_ms = (NowMs() + busy_ms);
+            job->page_addr += TML_SPM_PAGESIZE;
+            return TML_OK;
+        }
+    }
+    // Finished, or failed
+    job->done = true;
+    dev->stats.upload_ms += (NowMs() - job->start_ms);
+    if (result == TML_OK) {
+        dev->stats.bytes += job->size;
+    }
+    return result;
+}
+
+/* ________________________
+  |                        |
+  |  TmlUploadInterleaved  |
+  |________________________|
+*/
+int TmlUploadInterleaved(TmlDevice *devs[], TmlUploadJob *jobs[], uint8_t count, int results[]) {
+    // The devices share the bus, each page goes to the one that has been ready for the longest
+    // time, so the others are sent their pages while it's programming one.
+    int result = TML_OK;
+    for (uint8_t i = 0; i < count; i++) {
+        results[i] = TML_OK;
+    }
+    for (;;) {
+        int next = -1;
+        for (uint8_t i = 0; i < count; i++) {
+            if ((results[i] == TML_OK) && !jobs[i]->done && ((next < 0) || (jobs[i]->ready_ms < jobs[next]->ready_ms))) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        double wait_ms = (jobs[next]->ready_ms - NowMs());
+        if (wait_ms > 0) {
+            // All the devices are programming a page, the wait counts for each of them
+            SleepUs((uint32_t)(wait_ms * 1000.0));
+            for (uint8_t i = 0; i < count; i++) {
+                if ((results[i] == TML_OK) && !jobs[i]->done) {
+                    devs[i]->stats.wait_ms += wait_ms;
+                }
+            }
+        }
+        results[next] = TmlUploadPage(devs[next], jobs[next]);
+        if ((results[next] != TML_OK) && (result == TML_OK)) {
+            result = results[next];
+        }
+    }
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |      TmlVerify      |
+  |_____________________|
+*/
+int TmlVerify(TmlDevice *dev, const uint8_t *image, uint16_t size) {
+    uint8_t flash[TML_FLASH_SIZE];
+    uint8_t data[TML_MAX_PACKET_SIZE];
+    bool read_flash = !(dev->read_stream || dev->image_crc);
+    if (read_flash && !((dev->info.features >> TML_FT_CMD_READFLASH) & true)) {
+        return TML_ERR_FEATURE;
+    }
+    if ((read_flash && ((dev->read_size == 0) || (dev->read_size > TML_MAX_PACKET_SIZE))) || (size > AppLimit(dev))) {
+        return TML_ERR_SIZE;
+    }
+    PrepareImage(dev, image, size, flash);
+    double start = NowMs();
+    int result = TML_OK;
+    if (dev->image_crc) {
+        // The device restores the reset vector and blanks the trampoline, so its CRC of the
+        // written pages matches the image padded with blank bytes. The pages after them may
+        // keep an older application when it wasn't deleted first (erase-on-write).
+        uint16_t end = (uint16_t)((size + TML_SPM_PAGESIZE - 1) & ~(TML_SPM_PAGESIZE - 1));
+        uint16_t device_crc, crc = 0x0000;
+        for (uint16_t i = 0; i < end; i++) {
+            crc = TmlCrc16(crc, ((i < size) ? image[i] : 0xFF));
+        }
+        result = TmlGetImageCrc(dev, 0, end, &device_crc);
+        if ((result == TML_OK) && (device_crc != crc)) {
+            result = TML_ERR_VERIFY;
+        }
+        dev->stats.verify_ms += (NowMs() - start);
+        return result;
+    }
+    if (dev->read_stream) {
+        // The whole application and the trampoline, each one in a single stream
+        uint8_t stream[TML_FLASH_SIZE];
+        uint16_t tpl_addr = (dev->info.start_addr - 2);
+        result = TmlReadStream(dev, 0, stream, size);
+        if ((result == TML_OK) && memcmp(stream, flash, size)) {
+            result = TML_ERR_VERIFY;
+        }
+        if (result == TML_OK) {
+            result = TmlReadStream(dev, tpl_addr, stream, 2);
+        }
+        if ((result == TML_OK) && memcmp(stream, &flash[tpl_addr], 2)) {
+            result = TML_ERR_VERIFY;
+        }
+        dev->stats.verify_ms += (NowMs() - start);
+        return result;
+    }
+    for (uint16_t addr = 0; (addr < size) && (result == TML_OK); addr += dev->read_size) {
+        uint8_t block = (((size - addr) < dev->read_size) ? (size - addr) : dev->read_size);
+        result = TmlReadFlash(dev, addr, data, block);
+        if ((result == TML_OK) && memcmp(data, &flash[addr], block)) {
+            result = TML_ERR_VERIFY;
+        }
+    }
+    if (result == TML_OK) {
+        // Check the trampoline to the application
+        uint16_t tpl_addr = (dev->info.start_addr - 2);
+        result = TmlReadFlash(dev, tpl_addr, data, 2);
+        if ((result == TML_OK) && memcmp(data, &flash[tpl_addr], 2)) {
+            result = TML_ERR_VERIFY;
+        }
+    }
+    dev->stats.verify_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |    TmlSlotStart     |
+  |_____________________|
+*/
+uint16_t TmlSlotStart(TmlDevice *dev, uint8_t slot) {
+    // Page 0 and the trampoline page are kept by Timonel, the rest is split in two slots
+    return (TML_SPM_PAGESIZE + ((slot == 1) ? TmlSlotSize(dev) : 0));
+}
+
+/* _____________________
+  |                     |
+  |     TmlSlotSize     |
+  |_____________________|
+*/
+uint16_t TmlSlotSize(TmlDevice *dev) {
+    if (dev->info.start_addr < (2 * TML_SPM_PAGESIZE)) {
+        return 0;
+    }
+    return ((((dev->info.start_addr - (2 * TML_SPM_PAGESIZE)) / 2) / TML_SPM_PAGESIZE) * TML_SPM_PAGESIZE);
+}
+
+/* _____________________
+  |                     |
+  |    TmlActiveSlot    |
+  |_____________________|
+*/
+int TmlActiveSlot(TmlDevice *dev) {
+    // Decode the trampoline "rjmp", it jumps to the active slot reset vector
+    uint16_t tpl = dev->info.trampoline;
+    if ((tpl & 0xF000) != 0xC000) {
+        return -1;  // No application
+    }
+    int16_t offset = (int16_t)((tpl & 0x0800) ? ((tpl & 0x0FFF) - 0x1000) : (tpl & 0x0FFF));
+    uint16_t target = (uint16_t)((dev->info.start_addr + (offset * 2)) & (TML_FLASH_SIZE - 1));
+    if (target == TmlSlotStart(dev, 0)) {
+        return 0;
+    }
+    if (target == TmlSlotStart(dev, 1)) {
+        return 1;
+    }
+    return -1;
+}
+
+/* _____________________
+  |                     |
+  |    TmlSlotUpload    |
+  |_____________________|
+*/
+int TmlSlotUpload(TmlDevice *dev, uint8_t slot, const uint8_t *image, uint16_t size) {
+    if (!((dev->info.features >> TML_FT_CMD_SETPGADDR) & true) && ((dev->info.features >> TML_FT_AUTO_PAGE_ADDR) & true)) {
+        return TML_ERR_FEATURE;
+    }
+    int result = CheckSlotImage(dev, slot, image, size);
+    if (result != TML_OK) {
+        return result;
+    }
+    // Timonel erases each slot page before writing it, the image is sent as is
+    uint16_t end = (uint16_t)((size + TML_SPM_PAGESIZE - 1) & ~(TML_SPM_PAGESIZE - 1));
+    uint16_t burst_next = 0xFFFF;
+    double start = NowMs();
+    for (uint16_t page_addr = TmlSlotStart(dev, slot); page_addr < end; page_addr += TML_SPM_PAGESIZE) {
+        uint8_t page_data[TML_SPM_PAGESIZE];
+        memset(page_data, 0xFF, sizeof(page_data));
+        memcpy(page_data, &image[page_addr], (((size - page_addr) < TML_SPM_PAGESIZE) ? (size - page_addr) : TML_SPM_PAGESIZE));
+        result = NextPageAddr(dev, page_addr, (end - TML_SPM_PAGESIZE), &burst_next);
+        if (result != TML_OK) {
+            break;
+        }
+        uint8_t busy_ms = 0;
+        result = SendPage(dev, page_addr, page_data, &burst_next, &busy_ms);
+        if (result != TML_OK) {
+            break;
+        }
+        dev->stats.pages++;
+        if (!dev->busy_byte) {
+            busy_ms = (dev->page_delay_ms * 2);  // The page is erased before writing it
+        }
+        double wait_start = NowMs();
+        SleepMs(busy_ms);
+        dev->stats.wait_ms += (NowMs() - wait_start);
+    }
+    dev->stats.upload_ms += (NowMs() - start);
+    if (result == TML_OK) {
+        dev->stats.bytes += (size - TmlSlotStart(dev, slot));
+    }
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |    TmlSlotVerify    |
+  |_____________________|
+*/
+int TmlSlotVerify(TmlDevice *dev, uint8_t slot, const uint8_t *image, uint16_t size) {
+    uint8_t data[TML_FLASH_SIZE];
+    bool read_flash = !(dev->read_stream || dev->image_crc);
+    if (read_flash && !((dev->info.features >> TML_FT_CMD_READFLASH) & true)) {
+        return TML_ERR_FEATURE;
+    }
+    if (read_flash && ((dev->read_size == 0) || (dev->read_size > TML_MAX_PACKET_SIZE))) {
+        return TML_ERR_SIZE;
+    }
+    int result = CheckSlotImage(dev, slot, image, size);
+    if (result != TML_OK) {
+        return result;
+    }
+    // The slot holds the image as it was sent, there is no reset vector or trampoline in it
+    uint16_t slot_start = TmlSlotStart(dev, slot);
+    uint16_t length = (size - slot_start);
+    double start = NowMs();
+    if (dev->image_crc) {
+        uint16_t device_crc, crc = 0x0000;
+        for (uint16_t i = 0; i < length; i++) {
+            crc = TmlCrc16(crc, image[slot_start + i]);
+        }
+        result = TmlGetImageCrc(dev, slot_start, length, &device_crc);
+        if ((result == TML_OK) && (device_crc != crc)) {
+            result = TML_ERR_VERIFY;
+        }
+    } else if (dev->read_stream) {
+        result = TmlReadStream(dev, slot_start, data, length);
+        if ((result == TML_OK) && memcmp(data, &image[slot_start], length)) {
+            result = TML_ERR_VERIFY;
+        }
+    } else {
+        for (uint16_t ix = 0; (ix < length) && (result == TML_OK); ix += dev->read_size) {
+            uint8_t block = (((length - ix) < dev->read_size) ? (length - ix) : dev->read_size);
+            result = TmlReadFlash(dev, (slot_start + ix), data, block);
+            if ((result == TML_OK) && memcmp(data, &image[slot_start + ix], block)) {
+                result = TML_ERR_VERIFY;
+            }
+        }
+    }
+    dev->stats.verify_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |   TmlEepromUpload   |
+  |_____________________|
+*/
+int TmlEepromUpload(TmlDevice *dev, uint16_t addr, const uint8_t *data, uint16_t size) {
+    if ((size == 0) || (((uint32_t)addr + size) > TML_EEPROM_SIZE) || (dev->packet_size == 0)) {
+        return TML_ERR_SIZE;
+    }
+    double start = NowMs();
+    int result = TML_OK;
+    for (uint16_t ix = 0; (ix < size) && (result == TML_OK); ix += dev->packet_size) {
+        uint8_t block = (((size - ix) < dev->packet_size) ? (size - ix) : dev->packet_size);
+        uint8_t tries = 0;
+        do {
+            result = TmlWriteEeprom(dev, (addr + ix), &data[ix], block);
+            if (result == TML_ERR_REJECTED) {
+                dev->stats.retries++;
+            }
+        } while ((result == TML_ERR_REJECTED) && (tries++ < dev->retries));
+    }
+    dev->stats.eeprom_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |   TmlEepromVerify   |
+  |_____________________|
+*/
+int TmlEepromVerify(TmlDevice *dev, uint16_t addr, const uint8_t *data, uint16_t size) {
+    uint8_t eeprom[TML_MAX_PACKET_SIZE];
+    if ((size == 0) || (((uint32_t)addr + size) > TML_EEPROM_SIZE) || (dev->read_size == 0)) {
+        return TML_ERR_SIZE;
+    }
+    double start = NowMs();
+    int result = TML_OK;
+    for (uint16_t ix = 0; (ix < size) && (result == TML_OK); ix += dev->read_size) {
+        uint8_t block = (((size - ix) < dev->read_size) ? (size - ix) : dev->read_size);
+        result = TmlReadEeprom(dev, (addr + ix), eeprom, block);
+        if ((result == TML_OK) && memcmp(eeprom, &data[ix], block)) {
+            result = TML_ERR_VERIFY;
+        }
+    }
+    dev->stats.eeprom_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |   TmlCalibrateOsc   |
+  |_____________________|
+*/
+int TmlCalibrateOsc(TmlDevice *dev, uint8_t *osccal) {
+    uint8_t target, safe;
+    double start = NowMs();
+    // Sending the current setting only confirms it, and tells if the bootloader has TUNEOSCC
+    int result = TmlTuneOsc(dev, dev->info.osccal, &target, &safe);
+    if (result == TML_ERR_ACK) {
+        result = TML_ERR_FEATURE;
+    }
+    double base_ms = 0;
+    if (result == TML_OK) {
+        result = ProbeOscillator(dev, &base_ms);
+    }
+    uint8_t first = safe;
+    uint8_t last = safe;
+    // Step the oscillator up within its frequency range while the transfers keep running error-free
+    for (uint16_t setting = (first + OSC_TUNE_STEP); (result == TML_OK) && (setting <= 0xFF) &&
+                                                     ((setting & 0x80) == (first & 0x80));
+         setting += OSC_TUNE_STEP) {
+        // Timonel answers the trial at the current setting and moves to the new one afterwards
+        int trial = TmlTuneOsc(dev, (uint8_t)setting, &target, &safe);
+        if ((trial == TML_OK) && (target != setting)) {
+            break;  // Setting refused, this is the end of the range
+        }
+        double probe_ms = 0;
+        if (trial == TML_OK) {
+            trial = ProbeOscillator(dev, &probe_ms);
+        }
+        if ((trial == TML_OK) && (probe_ms > (base_ms * 1.5))) {
+            trial = TML_ERR_IO;  // Much longer clock stretching, the firmware is struggling
+        }
+        if (trial == TML_OK) {
+            trial = TmlTuneOsc(dev, (uint8_t)setting, &target, &safe);
+        }
+        if ((trial != TML_OK) || (safe != setting)) {
+            // Ask for the last confirmed setting until Timonel answers at it: either it reverted on
+            // its own, or the first answered request moved it back there and the second confirms it.
+            result = TML_ERR_TIMEOUT;
+            for (uint16_t waited = 0; waited < OSC_REVERT_TIMEOUT_MS; waited += OSC_REVERT_POLL_MS) {
+                SleepMs(OSC_REVERT_POLL_MS);
+                if ((TmlTuneOsc(dev, last, &target, &safe) == TML_OK) && (safe == last) &&
+                    (TmlTuneOsc(dev, last, &target, &safe) == TML_OK) && (target == last) && (safe == last)) {
+                    result = TML_OK;
+                    break;
+                }
+            }
+            break;
+        }
+        last = safe;
+    }
+    // Keep a margin below the fastest setting, for voltage and temperature changes
+    if (result == TML_OK) {
+        uint8_t setting = (((last - first) > OSC_TUNE_MARGIN) ? (last - OSC_TUNE_MARGIN) : first);
+        if (setting != last) {
+            result = TmlTuneOsc(dev, setting, &target, &safe);
+            if (result == TML_OK) {
+                result = TmlTuneOsc(dev, setting, &target, &safe);
+            }
+            if ((result == TML_OK) && (safe != setting)) {
+                result = TML_ERR_VERIFY;
+            }
+        }
+    }
+    if (result == TML_OK) {
+        result = TmlGetVersion(dev);
+        *osccal = safe;
+    }
+    dev->stats.tune_ms += (NowMs() - start);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |     TmlLoadFile     |
+  |_____________________|
+*/
+int TmlLoadFile(const char *path, uint8_t *image, uint16_t *size) {
+    FILE *input = fopen(path, "rb");
+    if (input == NULL) {
+        fprintf(stderr, "Error opening %s: %s\n", path, strerror(errno));
+        return TML_ERR_FILE;
+    }
+    memset(image, 0xFF, TML_FLASH_SIZE);
+    *size = 0;
+    int result = TML_OK;
+    const char *extension = strrchr(path, '.');
+    if ((extension != NULL) && ((strcmp(extension, ".hex") == 0) || (strcmp(extension, ".ihx") == 0))) {
+        result = ParseIntelHex(input, path, image, size);
+    } else {
+        // Raw binary image starting at address 0
+        size_t read_len = fread(image, 1, TML_FLASH_SIZE, input);
+        if ((read_len == TML_FLASH_SIZE) && (fgetc(input) != EOF)) {
+            result = TML_ERR_SIZE;
+        }
+        *size = (uint16_t)read_len;
+    }
+    fclose(input);
+    return result;
+}
+
+/* _____________________
+  |                     |
+  |      TmlCrc16       |
+  |_____________________|
+*/
+uint16_t TmlCrc16(uint16_t crc, uint8_t data) {
+    // CRC-16/XMODEM (polynomial 0x1021), same as avr-libc "_crc_xmodem_update"
+    crc ^= ((uint16_t)data << 8);
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = ((crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1));
+    }
+    return crc;
+}
+
+/* _____________________
+  |                     |
+  |     TmlStrError     |
+  |_____________________|
+*/
+const char *TmlStrError(int error) {
+    switch (error) {
+        case TML_OK:
+            return "OK";
+        case TML_ERR_IO:
+            return "I2C bus transfer failed";
+        case TML_ERR_ACK:
+            return "unexpected command acknowledge";
+        case TML_ERR_CHECKSUM:
+            return "checksum mismatch";
+        case TML_ERR_REJECTED:
+            return "packet rejected by the device";
+        case TML_ERR_SIZE:
+            return "application or packet size out of range";
+        case TML_ERR_FEATURE:
+            return "not supported by the bootloader features";
+        case TML_ERR_VERIFY:
+            return "memory contents don't match";
+        case TML_ERR_TIMEOUT:
+            return "device didn't restart";
+        case TML_ERR_FILE:
+            return "application file error";
+        case TML_ERR_RESTART:
+            return "page rejected by the device";
+        default:
+            return "unknown error";
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+////////////               INTERNAL FUNCTIONS BELOW              ////////////
+/////////////////////////////////////////////////////////////////////////////
+
+// Send a command and read its reply. By default, both go in a single ioctl joined by a
+// repeated start. With "split", a stop is sent and the reply is read after a delay.
+static int TwiCommand(TmlDevice *dev, const uint8_t *command, uint8_t command_len, uint8_t *reply, uint16_t reply_len) {
+    struct i2c_msg msgs[2] = {
+        {.addr = dev->addr, .flags = 0, .len = command_len, .buf = (uint8_t *)command},
+        {.addr = dev->addr, .flags = I2C_M_RD, .len = reply_len, .buf = reply},
+    };
+    if (dev->split) {
+        for (uint8_t i = 0; i < 2; i++) {
+            struct i2c_rdwr_ioctl_data transfer = {.msgs = &msgs[i], .nmsgs = 1};
+            if (ioctl(dev->fd, I2C_RDWR, &transfer) < 0) {
+                return TML_ERR_IO;
+            }
+            dev->stats.transactions++;
+            if (i == 0) {
+                usleep(dev->reply_delay_us);
+            }
+        }
+    } else {
+        struct i2c_rdwr_ioctl_data transfer = {.msgs = msgs, .nmsgs = 2};
+        if (ioctl(dev->fd, I2C_RDWR, &transfer) < 0) {
+            return TML_ERR_IO;
+        }
+        dev->stats.transactions++;
+    }
+    return TML_OK;
+}
+
+// Read without sending a command first, Timonel keeps on sending the current READSTRM stream
+static int TwiRead(TmlDevice *dev, uint8_t *data, uint16_t data_len) {
+    struct i2c_msg msg = {.addr = dev->addr, .flags = I2C_M_RD, .len = data_len, .buf = data};
+    struct i2c_rdwr_ioctl_data transfer = {.msgs = &msg, .nmsgs = 1};
+    if (ioctl(dev->fd, I2C_RDWR, &transfer) < 0) {
+        return TML_ERR_IO;
+    }
+    dev->stats.transactions++;
+    return TML_OK;
+}
+
+// Write a page one packet at a time, from the page offset ix. A packet rejected with NAKWTPAG is
+// resent, while after a NAKPGRST (STREAM_PAGE_FILL) the device cleared its page buffer, so the
+// page starts over.
+static int WritePage(TmlDevice *dev, const uint8_t *page_data, uint16_t ix, uint8_t *busy_ms) {
+    uint8_t tries = 0;
+    uint8_t restarts = 0;
+    while (ix < TML_SPM_PAGESIZE) {
+        int result = TmlWritePacket(dev, &page_data[ix], busy_ms);
+        if ((result == TML_ERR_REJECTED) && (tries < dev->retries)) {
+            tries++;
+            dev->stats.retries++;
+            continue;
+        }
+        if ((result == TML_ERR_RESTART) && (restarts < dev->retries)) {
+            restarts++;
+            dev->stats.retries++;
+            tries = 0;
+            ix = 0;
+            continue;
+        }
+        if (result != TML_OK) {
+            return result;
+        }
+        tries = 0;
+        ix += dev->packet_size;
+    }
+    return TML_OK;
+}
+
+// Write a page, with page batches in a single ioctl. When the rejected packet was the last one of
+// its ioctl, the upload goes on from it one packet at a time. Otherwise the next packets were
+// already written at the wrong place, so the device page index is reset with STPGADDR and the
+// page is written again, which needs CMD_SETPGADDR.
+static int SendPage(TmlDevice *dev, uint16_t page_addr, const uint8_t *page_data, uint16_t *burst_next,
+                    uint8_t *busy_ms) {
+    if (!dev->page_batch || dev->split) {
+        return WritePage(dev, page_data, 0, busy_ms);
+    }
+    uint16_t resume_ix = 0xFFFF;
+    int result = WritePageBatch(dev, page_data, busy_ms, &resume_ix);
+    if ((result != TML_ERR_REJECTED) && (result != TML_ERR_RESTART)) {
+        return result;
+    }
+    dev->stats.retries++;
+    if (resume_ix != 0xFFFF) {
+        return WritePage(dev, page_data, resume_ix, busy_ms);
+    }
+    if ((dev->info.features >> TML_FT_CMD_SETPGADDR) & true) {
+        *burst_next = 0xFFFF;  // STPGADDR ends the STPGBRST burst
+        result = TmlSetPageAddr(dev, page_addr);
+        if (result == TML_OK) {
+            result = WritePage(dev, page_data, 0, busy_ms);
+        }
+    }
+    return result;
+}
+
+// Write a whole page sending all its packets in a single ioctl. For a rejected packet, resume_ix
+// is where the page can go on (0xFFFF: the device page index is out of step, see SendPage).
+static int WritePageBatch(TmlDevice *dev, const uint8_t *page_data, uint8_t *busy_ms, uint16_t *resume_ix) {
+    uint8_t commands[MAX_BATCH_PACKETS][1 + TML_MAX_PACKET_SIZE + 2];
+    uint8_t replies[MAX_BATCH_PACKETS][4];
+    struct i2c_msg msgs[MAX_BATCH_PACKETS * 2];
+    uint8_t packets = (TML_SPM_PAGESIZE / dev->packet_size);
+    for (uint8_t first = 0; first < packets; first += MAX_BATCH_PACKETS) {
+        uint8_t count = (((packets - first) < MAX_BATCH_PACKETS) ? (packets - first) : MAX_BATCH_PACKETS);
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t command_len = BuildPacket(dev, &page_data[(first + i) * dev->packet_size], commands[i]);
+            msgs[i * 2].addr = dev->addr;
+            msgs[i * 2].flags = 0;
+            msgs[i * 2].len = command_len;
+            msgs[i * 2].buf = commands[i];
+            msgs[(i * 2) + 1].addr = dev->addr;
+            msgs[(i * 2) + 1].flags = I2C_M_RD;
+            msgs[(i * 2) + 1].len = (command_len - dev->packet_size + (dev->busy_byte ? 1 : 0));
+            msgs[(i * 2) + 1].buf = replies[i];
+        }
+        struct i2c_rdwr_ioctl_data transfer = {.msgs = msgs, .nmsgs = (uint32_t)(count * 2)};
+        if (ioctl(dev->fd, I2C_RDWR, &transfer) < 0) {
+            return TML_ERR_IO;
+        }
+        dev->stats.transactions++;
+        dev->stats.packets += count;
+        for (uint8_t i = 0; i < count; i++) {
+            int result = CheckPacketReply(dev, commands[i], replies[i], busy_ms);
+            if ((result == TML_ERR_REJECTED) && (i == (count - 1))) {
+                *resume_ix = ((first + i) * dev->packet_size);  // Nothing else was written after it
+            } else if ((result == TML_ERR_RESTART) && (i == (count - 1))) {
+                *resume_ix = 0;  // The device went back to the page start
+            }
+            if (result != TML_OK) {
+                return result;
+            }
+        }
+    }
+    return TML_OK;
+}
+
+// Build a WRITPAGE command: opcode + packet data + checksum (CRC-16 MSB, LSB or 8-bit sum)
+static uint8_t BuildPacket(TmlDevice *dev, const uint8_t *data, uint8_t *command) {
+    uint8_t command_len = (1 + dev->packet_size);
+    command[0] = WRITPAGE;
+    memcpy(&command[1], data, dev->packet_size);
+    if ((dev->info.ext_features >> TML_EF_USE_CRC16) & true) {
+        uint16_t crc = 0x0000;
+        for (uint8_t i = 0; i < dev->packet_size; i++) {
+            crc = TmlCrc16(crc, data[i]);
+        }
+        command[command_len++] = (uint8_t)(crc >> 8);
+        command[command_len++] = (uint8_t)(crc & 0xFF);
+    } else {
+        uint8_t checksum = 0;
+        for (uint8_t i = 0; i < dev->packet_size; i++) {
+            checksum += data[i];
+        }
+        command[command_len++] = checksum;
+    }
+    return command_len;
+}
+
+// Check a WRITPAGE reply: acknowledge + the checksum computed by the device (+ busy time)
+static int CheckPacketReply(TmlDevice *dev, const uint8_t *command, const uint8_t *reply, uint8_t *busy_ms) {
+    uint8_t checksum_len = (((dev->info.ext_features >> TML_EF_USE_CRC16) & true) ? 2 : 1);
+    if (reply[0] == NAKWTPAG) {
+        return TML_ERR_REJECTED;
+    }
+    if (reply[0] == NAKPGRST) {
+        return TML_ERR_RESTART;  // STREAM_PAGE_FILL: the device page index went back to the page start
+    }
+    if (reply[0] != ACKWTPAG) {
+        return TML_ERR_ACK;
+    }
+    if (memcmp(&reply[1], &command[1 + dev->packet_size], checksum_len)) {
+        return TML_ERR_CHECKSUM;
+    }
+    if (dev->busy_byte) {
+        *busy_ms = reply[1 + checksum_len];
+    }
+    return TML_OK;
+}
+
+// Copy the image to a flash-sized buffer as it will be stored in the device: the reset
+// vector jumps to Timonel and the trampoline jumps to the application. Returns the image
+// end rounded up to a whole page.
+static uint16_t PrepareImage(TmlDevice *dev, const uint8_t *image, uint16_t size, uint8_t *flash) {
+    uint16_t start_addr = dev->info.start_addr;
+    memset(flash, 0xFF, TML_FLASH_SIZE);
+    memcpy(flash, image, size);
+    uint16_t app_reset = (uint16_t)((image[1] << 8) | image[0]);
+    uint16_t tpl = (((~((start_addr >> 1) - ((app_reset + 1) & 0x0FFF)) + 1) & 0x0FFF) | 0xC000);
+    uint16_t reset_vector = (0xC000 + ((start_addr / 2) - 1));
+    flash[0] = (uint8_t)(reset_vector & 0xFF);
+    flash[1] = (uint8_t)(reset_vector >> 8);
+    flash[start_addr - 2] = (uint8_t)(tpl & 0xFF);
+    flash[start_addr - 1] = (uint8_t)(tpl >> 8);
+    return (uint16_t)((size + TML_SPM_PAGESIZE - 1) & ~(TML_SPM_PAGESIZE - 1));
+}
+
+// Highest application size allowed by the bootloader features
+static uint16_t AppLimit(TmlDevice *dev) {
+    bool auto_page_addr = ((dev->info.features >> TML_FT_AUTO_PAGE_ADDR) & true);
+    bool app_use_tpl_pg = ((dev->info.features >> TML_FT_APP_USE_TPL_PG) & true);
+    if ((dev->info.start_addr < TML_SPM_PAGESIZE) || (dev->info.start_addr > TML_FLASH_SIZE)) {
+        return 0;
+    }
+    if (auto_page_addr && !app_use_tpl_pg) {
+        return (dev->info.start_addr - TML_SPM_PAGESIZE);  // The trampoline page is reserved
+    }
+    return (dev->info.start_addr - 2);  // Only the trampoline bytes are reserved
+}
+
+// A slot image must be linked to start at the slot address and fit in it
+static int CheckSlotImage(TmlDevice *dev, uint8_t slot, const uint8_t *image, uint16_t size) {
+    uint16_t slot_start = TmlSlotStart(dev, slot);
+    if ((slot > 1) || (TmlSlotSize(dev) == 0) || (size <= slot_start) || (size > (slot_start + TmlSlotSize(dev)))) {
+        return TML_ERR_SIZE;
+    }
+    for (uint16_t i = 0; i < slot_start; i++) {
+        if (image[i] != 0xFF) {
+            return TML_ERR_SIZE;
+        }
+    }
+    return TML_OK;
+}
+
+// Set the address of the next page to write. With page bursts, STPGBRST is sent only when
+// the page doesn't follow the previous one, covering all the pages up to the last one.
+static int NextPageAddr(TmlDevice *dev, uint16_t page_addr, uint16_t last_page, uint16_t *burst_next) {
+    if (!dev->page_burst) {
+        return TmlSetPageAddr(dev, page_addr);
+    }
+    int result = TML_OK;
+    if (page_addr != *burst_next) {
+        uint16_t page_count = (((last_page - page_addr) / TML_SPM_PAGESIZE) + 1);
+        result = TmlSetPageBurst(dev, page_addr, (uint8_t)((page_count > 0xFF) ? 0xFF : page_count));
+    }
+    *burst_next = ((result == TML_OK) ? (page_addr + TML_SPM_PAGESIZE) : 0xFFFF);
+    return result;
+}
+
+// Time a series of GETTMNLV transfers. Any error, or a reply that doesn't match the
+// bootloader information read at the initial setting, fails the OSCCAL setting being tried.
+static int ProbeOscillator(TmlDevice *dev, double *probe_ms) {
+    TmlInfo info = dev->info;
+    double start = NowMs();
+    int result = TML_OK;
+    for (uint8_t i = 0; (i < OSC_TUNE_PROBES) && (result == TML_OK); i++) {
+        result = TmlGetVersion(dev);
+        if ((result == TML_OK) &&
+            ((dev->info.signature != info.signature) || (dev->info.features != info.features) ||
+             (dev->info.ext_features != info.ext_features) || (dev->info.start_addr != info.start_addr) ||
+             (dev->info.trampoline != info.trampoline) || (dev->info.low_fuse != info.low_fuse))) {
+            result = TML_ERR_CHECKSUM;
+        }
+    }
+    if (result != TML_OK) {
+        dev->info = info;  // Don't keep a garbled reply
+    }
+    *probe_ms = (NowMs() - start);
+    return result;
+}
+
+static bool IsBlankPage(const uint8_t *page_data) {
+    for (uint8_t i = 0; i < TML_SPM_PAGESIZE; i++) {
+        if (page_data[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Minimal Intel HEX reader: data, end of file and extended address records
+static int ParseIntelHex(FILE *input, const char *path, uint8_t *image, uint16_t *size) {
+    char line[600];
+    uint32_t base = 0;
+    uint32_t line_number = 0;
+    while (fgets(line, sizeof(line), input) != NULL) {
+        line_number++;
+        char *record = strchr(line, ':');
+        if (record == NULL) {
+            continue;
+        }
+        uint8_t bytes[256 + 5];
+        unsigned int value;
+        size_t count = 0;
+        for (char *p = (record + 1); (sscanf(p, "%2x", &value) == 1) && (count < sizeof(bytes)); p += 2) {
+            bytes[count++] = (uint8_t)value;
+        }
+        if ((count < 5) || (count != (size_t)(bytes[0] + 5))) {
+            fprintf(stderr, "%s:%u: malformed record\n", path, (unsigned int)line_number);
+            return TML_ERR_FILE;
+        }
+        uint8_t checksum = 0;
+        for (size_t i = 0; i < count; i++) {
+            checksum += bytes[i];
+        }
+        if (checksum != 0) {
+            fprintf(stderr, "%s:%u: checksum error\n", path, (unsigned int)line_number);
+            return TML_ERR_FILE;
+        }
+        uint16_t offset = (uint16_t)((bytes[1] << 8) | bytes[2]);
+        switch (bytes[3]) {
+            case 0x00: {  // Data
+                uint32_t addr = (base + offset);
+                if ((addr + bytes[0]) > TML_FLASH_SIZE) {
+                    fprintf(stderr, "%s:%u: data beyond the flash memory\n", path, (unsigned int)line_number);
+                    return TML_ERR_SIZE;
+                }
+                memcpy(&image[addr], &bytes[4], bytes[0]);
+                if ((addr + bytes[0]) > *size) {
+                    *size = (uint16_t)(addr + bytes[0]);
+                }
+                break;
+            }
+            case 0x01: {  // End of file
+                return TML_OK;
+            }
+            case 0x02: {  // Extended segment address
+                base = ((uint32_t)((bytes[4] << 8) | bytes[5]) << 4);
+                break;
+            }
+            case 0x04: {  // Extended linear address
+                base = ((uint32_t)((bytes[4] << 8) | bytes[5]) << 16);
+                break;
+            }
+            default: {  // Start address records aren't used by the device
+                break;
+            }
+        }
+    }
+    return TML_OK;
+}
+
+static double NowMs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0));
+}
+
+static void SleepMs(uint32_t ms) {
+    struct timespec delay = {.tv_sec = (ms / 1000), .tv_nsec = ((ms % 1000) * 1000000L)};
+    while (nanosleep(&delay, &delay) && (errno == EINTR)) {
+    }
+}
+
+static void SleepUs(uint32_t us) {
+    struct timespec delay = {.tv_sec = (us / 1000000), .tv_nsec = ((us % 1000000) * 1000L)};
+    while (nanosleep(&delay, &delay) && (errno == EINTR)) {
+    }
+}
+
+// Wait until a device finishes programming its last page
+static void WaitReady(TmlDevice *dev, double ready_ms) {
+    double wait_start = NowMs();
+    if (ready_ms > wait_start) {
+        SleepUs((uint32_t)((ready_ms - wait_start) * 1000.0));
+        dev->stats.wait_ms += (NowMs() - wait_start);
+    }
+}
@@ -0,0 +1,253 @@
+/*
+ *  Timonel - TWI Bootloader for TinyX5 MCUs
+ *  Author: Gustavo Casanova
+ *  ...........................................
+ *  File: tml-twim.h (Linux host TWI master library headers)
+ *  ...........................................
+ *  Version: 0.1 / 2020-06-06
+ *  gustavo.casanova@nicebots.com
+ *  ...........................................
+ */
+
+#ifndef TML_TWIM_H
+#define TML_TWIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Timonel commands (same values as "nb-twi-cmd.h")
+#ifndef GETTMNLV
+#define INITSOFT 0x81 /* Initialize Timonel (two-step init, second step) */
+#define ACKINITS 0x7E /* INITSOFT command acknowledge */
+#define GETTMNLV 0x82 /* Get Timonel version and features */
+#define ACKTMNLV 0x7D /* GETTMNLV command acknowledge */
+#define DELFLASH 0x83 /* Delete the application from flash memory */
+#define ACKDELFL 0x7C /* DELFLASH command acknowledge */
+#define STPGADDR 0x84 /* Set the flash memory page address to write */
+#define AKPGADDR 0x7B /* STPGADDR command acknowledge */
+#define WRITPAGE 0x85 /* Write a data packet into the flash page buffer */
+#define ACKWTPAG 0x7A /* WRITPAGE command acknowledge */
+#define EXITTMNL 0x86 /* Exit Timonel and run the application */
+#define ACKEXITT 0x79 /* EXITTMNL command acknowledge */
+#define READFLSH 0x87 /* Read a flash memory block */
+#define ACKRDFSH 0x78 /* READFLSH command acknowledge */
+#endif                /* GETTMNLV */
+#ifndef NAKWTPAG
+#define NAKWTPAG 0xFA /* WRITPAGE packet rejected by checksum, the master should resend it */
+#endif                /* NAKWTPAG */
+#ifndef NAKPGRST
+#define NAKPGRST 0xF9 /* WRITPAGE packet rejected and page buffer cleared, the master should resend the whole page */
+#endif                /* NAKPGRST */
+#ifndef READSTRM
+#define READSTRM 0x8E /* Read a flash memory range of any length as one stream, ending with its CRC-16 */
+#define ACKRDSTM 0x71 /* READSTRM command acknowledge */
+#endif                /* READSTRM */
+#ifndef GETIMCRC
+#define GETIMCRC 0x8F /* Get the CRC-16 of the application image, as it was sent by the master */
+#define ACKIMCRC 0x70 /* GETIMCRC command acknowledge */
+#endif                /* GETIMCRC */
+#define IMCRC_READY 0x00  /* GETIMCRC status: the CRC of the range is ready */
+#define IMCRC_BUSY 0x01   /* GETIMCRC status: the CRC is being calculated, ask again */
+#define IMCRC_BADRNG 0xFF /* GETIMCRC status: the range isn't within the application area */
+#ifndef DELPAGES
+#define DELPAGES 0x90 /* Delete a range of application flash memory pages, without restarting */
+#define ACKDELPG 0x6F /* DELPAGES command acknowledge */
+#endif                /* DELPAGES */
+#ifndef WRITEEPB
+#define WRITEEPB 0x91 /* Write a block of EEPROM bytes, skipping the ones that already hold the value */
+#define ACKWTEPB 0x6E /* WRITEEPB command acknowledge */
+#endif                /* WRITEEPB */
+#ifndef READEEPB
+#define READEEPB 0x92 /* Read a block of EEPROM bytes */
+#define ACKRDEPB 0x6D /* READEEPB command acknowledge */
+#endif                /* READEEPB */
+#ifndef SWITSLOT
+#define SWITSLOT 0x93 /* Switch the active application slot (A/B slots) */
+#define ACKSWSLT 0x6C /* SWITSLOT command acknowledge */
+#endif                /* SWITSLOT */
+#ifndef READSTAT
+#define READSTAT 0x94 /* Read the runtime statistics counters */
+#define ACKRDSTA 0x6B /* READSTAT command acknowledge */
+#endif                /* READSTAT */
+#ifndef STPGBRST
+#define STPGBRST 0x95 /* Set the first page address and page count of a multi-page WRITPAGE burst */
+#define AKPGBRST 0x6A /* STPGBRST command acknowledge */
+#endif                /* STPGBRST */
+#ifndef TUNEOSCC
+#define TUNEOSCC 0x96 /* Try or confirm an internal RC oscillator calibration (OSCCAL) setting */
+#define ACKTNOSC 0x69 /* TUNEOSCC command acknowledge */
+#endif                /* TUNEOSCC */
+
+// Device memory definitions
+#ifndef TML_SPM_PAGESIZE
+#define TML_SPM_PAGESIZE 64     /* ATtiny85 flash memory page size (128: ATtiny87) */
+#endif                          /* TML_SPM_PAGESIZE */
+#define TML_FLASH_SIZE 8192     /* ATtiny85 flash memory size */
+#define TML_EEPROM_SIZE 512     /* ATtiny85 EEPROM size */
+#define TML_GETTMNLV_RPLYLN 12  /* GETTMNLV command reply length */
+#define TML_READSTAT_RPLYLN 19  /* READSTAT command reply length */
+#define TML_STATS_TICK_CLKS 1024 /* CPU clock cycles per READSTAT slow-op time tick */
+#define TML_TUNEOSCC_RPLYLN 8   /* TUNEOSCC command reply length */
+#define TML_MAX_PACKET_SIZE TML_SPM_PAGESIZE /* Maximum MST_PACKET_SIZE and SLV_PACKET_SIZE */
+
+// GETTMNLV features byte bits
+#define TML_FT_ENABLE_LED_UI 0
+#define TML_FT_AUTO_PAGE_ADDR 1
+#define TML_FT_APP_USE_TPL_PG 2
+#define TML_FT_CMD_SETPGADDR 3
+#define TML_FT_TWO_STEP_INIT 4
+#define TML_FT_USE_WDT_RESET 5
+#define TML_FT_APP_AUTORUN 6
+#define TML_FT_CMD_READFLASH 7
+
+// GETTMNLV extended features byte bits
+#define TML_EF_AUTO_CLK_TWEAK 0
+#define TML_EF_FORCE_ERASE_PG 1
+#define TML_EF_CLEAR_BIT_7_R31 2
+#define TML_EF_CHECK_PAGE_IX 3
+#define TML_EF_CMD_READDEVS 4
+#define TML_EF_EEPROM_ACCESS 5
+#define TML_EF_CMD_GETPGCRC 6
+#define TML_EF_USE_CRC16 7
+
+// Error codes (functions return 0 on success)
+#define TML_OK 0
+#define TML_ERR_IO -1       /* I2C bus transfer failed */
+#define TML_ERR_ACK -2      /* Unexpected command acknowledge */
+#define TML_ERR_CHECKSUM -3 /* Checksum or CRC mismatch */
+#define TML_ERR_REJECTED -4 /* Packet rejected (NAKWTPAG) after all the retries */
+#define TML_ERR_SIZE -5     /* The application doesn't fit in the available flash memory */
+#define TML_ERR_FEATURE -6  /* Operation not supported by the bootloader features */
+#define TML_ERR_VERIFY -7   /* Flash memory or EEPROM contents don't match */
+#define TML_ERR_TIMEOUT -8  /* The device didn't come back after restarting */
+#define TML_ERR_FILE -9     /* Application file can't be read or parsed */
+#define TML_ERR_RESTART -10 /* Packet rejected and page buffer cleared (NAKPGRST), the page has to be resent */
+
+// Bootloader information returned by GETTMNLV
+typedef struct tml_info {
+    uint8_t signature;      // "T" signature
+    uint8_t version_major;  // Timonel version major number
+    uint8_t version_minor;  // Timonel version minor number
+    uint8_t features;       // Optional features byte
+    uint8_t ext_features;   // Extended optional features byte
+    uint16_t start_addr;    // Bootloader start address
+    uint16_t trampoline;    // Trampoline instruction (jump to the application)
+    uint8_t low_fuse;       // Low fuse bits
+    uint8_t osccal;         // Internal RC oscillator calibration
+} TmlInfo;
+
+// Bootloader runtime statistics returned by READSTAT (bootloader CMD_READSTAT)
+typedef struct tml_dev_stats {
+    uint8_t reset_flags;  // MCUSR reset flags of the last restart
+    uint16_t restarts;    // Timonel starts since the counters were cleared
+    uint16_t rejected;    // Packets rejected by checksum
+    uint16_t del_flash;   // DELFLASH runs
+    uint16_t broadcasts;  // General call commands run
+    uint16_t pages;       // Flash pages written
+    uint32_t slow_ticks;  // Time spent in slow-ops, in TML_STATS_TICK_CLKS CPU clock cycles units
+} TmlDevStats;
+
+// Per-phase timing and transfer statistics
+typedef struct tml_stats {
+    double enter_ms;        // Application command to enter Timonel, until it answers
+    double init_ms;         // GETTMNLV (+ INITSOFT) time
+    double delete_ms;       // DELFLASH time, including the device restart
+    double upload_ms;       // WRITPAGE (+ STPGADDR) time, including the page write waits
+    double wait_ms;         // Part of the upload time spent waiting for page writes
+    double verify_ms;       // READFLSH time
+    double exit_ms;         // EXITTMNL time
+    double switch_ms;       // SWITSLOT time, including the trampoline page write
+    double eeprom_ms;       // WRITEEPB (+ READEEPB) time, including the EEPROM write waits
+    double tune_ms;         // TUNEOSCC oscillator calibration time, including the trial reverts
+    uint32_t bytes;         // Application bytes uploaded
+    uint32_t eeprom_bytes;  // EEPROM bytes written, the ones that already held the value are skipped
+    uint32_t pages;         // Flash pages written
+    uint32_t packets;       // WRITPAGE packets sent
+    uint32_t retries;       // WRITPAGE packets resent
+    uint32_t transactions;  // I2C transactions (one ioctl each)
+} TmlStats;
+
+// TWI slave device running Timonel
+typedef struct tml_device {
+    int fd;                   // "/dev/i2c-N" file descriptor
+    int bus;                  // I2C bus number
+    uint8_t addr;             // Device TWI address
+    uint8_t packet_size;      // WRITPAGE data bytes per packet (bootloader MST_PACKET_SIZE)
+    uint8_t read_size;        // READFLSH data bytes per reply (bootloader SLV_PACKET_SIZE)
+    bool busy_byte;           // WRITPAGE replies carry the busy time (bootloader WRITPAGE_BUSY)
+    bool page_batch;          // Send all the packets of a page in a single ioctl
+    bool page_burst;          // Set the page address once per run of consecutive pages (bootloader CMD_PGBURST)
+    bool split;               // Use separate write and read transactions instead of a repeated start
+    bool read_stream;         // Verify with READSTRM instead of READFLSH (bootloader CMD_READSTRM)
+    uint16_t stream_chunk;    // READSTRM bytes per read transfer (0: the whole range in one transfer)
+    bool image_crc;           // Verify with GETIMCRC instead of reading the flash back (bootloader CMD_GETIMCRC)
+    uint16_t reply_delay_us;  // Delay between write and read when split is enabled
+    uint16_t page_delay_ms;   // Page write wait when busy_byte is disabled
+    uint8_t retries;          // Times a rejected packet is resent
+    TmlInfo info;             // Last GETTMNLV reply
+    TmlStats stats;           // Accumulated statistics
+} TmlDevice;
+
+// Application upload in progress, written one page at a time by TmlUploadPage
+typedef struct tml_upload_job {
+    uint8_t flash[TML_FLASH_SIZE];  // Image to send, with the reset vector and trampoline prepared
+    uint16_t size;                  // Application size
+    uint16_t end;                   // Image end, rounded up to a page
+    uint16_t tpl_page;              // Trampoline page address
+    uint16_t burst_next;            // Next page covered by the STPGBRST burst (0xFFFF: none)
+    uint32_t page_addr;             // Next page to write
+    bool erased;                    // The application was deleted before, blank pages are skipped
+    bool done;                      // All the pages were written, or the upload failed
+    double start_ms;                // Upload start time
+    double ready_ms;                // Time when the device finishes programming the last page
+} TmlUploadJob;
+
+// Device handling
+void TmlDeviceInit(TmlDevice *dev, int bus, uint8_t addr);
+int TmlOpen(TmlDevice *dev);
+void TmlClose(TmlDevice *dev);
+
+// Bootloader commands
+int TmlGetVersion(TmlDevice *dev);
+int TmlInitSoft(TmlDevice *dev);
+int TmlDeleteFlash(TmlDevice *dev);
+int TmlDeletePages(TmlDevice *dev, uint16_t page_addr, uint8_t page_count);
+int TmlSetPageAddr(TmlDevice *dev, uint16_t page_addr);
+int TmlSetPageBurst(TmlDevice *dev, uint16_t page_addr, uint8_t page_count);
+int TmlWritePacket(TmlDevice *dev, const uint8_t *data, uint8_t *busy_ms);
+int TmlReadFlash(TmlDevice *dev, uint16_t addr, uint8_t *data, uint8_t size);
+int TmlReadStream(TmlDevice *dev, uint16_t addr, uint8_t *data, uint16_t size);
+int TmlGetImageCrc(TmlDevice *dev, uint16_t addr, uint16_t length, uint16_t *crc);
+int TmlWriteEeprom(TmlDevice *dev, uint16_t addr, const uint8_t *data, uint8_t size);
+int TmlReadEeprom(TmlDevice *dev, uint16_t addr, uint8_t *data, uint8_t size);
+int TmlExit(TmlDevice *dev);
+int TmlSwitchSlot(TmlDevice *dev, uint8_t slot);
+int TmlReadStats(TmlDevice *dev, TmlDevStats *dev_stats, bool clear);
+int TmlTuneOsc(TmlDevice *dev, uint8_t osccal, uint8_t *target, uint8_t *safe);
+
+// High-level operations
+int TmlEnterBootloader(TmlDevice *dev, uint8_t app_addr, uint8_t app_command);
+int TmlInitialize(TmlDevice *dev);
+int TmlUpload(TmlDevice *dev, const uint8_t *image, uint16_t size, bool erased);
+int TmlUploadBegin(TmlDevice *dev, TmlUploadJob *job, const uint8_t *image, uint16_t size, bool erased);
+int TmlUploadPage(TmlDevice *dev, TmlUploadJob *job);
+int TmlUploadInterleaved(TmlDevice *devs[], TmlUploadJob *jobs[], uint8_t count, int results[]);
+int TmlVerify(TmlDevice *dev, const uint8_t *image, uint16_t size);
+int TmlEepromUpload(TmlDevice *dev, uint16_t addr, const uint8_t *data, uint16_t size);
+int TmlEepromVerify(TmlDevice *dev, uint16_t addr, const uint8_t *data, uint16_t size);
+int TmlCalibrateOsc(TmlDevice *dev, uint8_t *osccal);
+
+// A/B application slots (bootloader APP_AB_SLOTS), the images are linked to start at their slot address
+uint16_t TmlSlotStart(TmlDevice *dev, uint8_t slot);
+uint16_t TmlSlotSize(TmlDevice *dev);
+int TmlActiveSlot(TmlDevice *dev);
+int TmlSlotUpload(TmlDevice *dev, uint8_t slot, const uint8_t *image, uint16_t size);
+int TmlSlotVerify(TmlDevice *dev, uint8_t slot, const uint8_t *image, uint16_t size);
+
+// Helpers
+int TmlLoadFile(const char *path, uint8_t *image, uint16_t *size);
+uint16_t TmlCrc16(uint16_t crc, uint8_t data);
+const char *TmlStrError(int error);
+
+#endif  // TML_TWIM_H
@@ -17,8 +17,9 @@
 // progmem array with the bootloader data, and you're ready to go.
 // 
 // Upgrade will firstly rewrite the interrupt vector table to disable the bootloader,
-// rewriting it to just run the upgrade app. Next it erases and writes each page of the
-// bootloader in sequence, erasing over any remaining pages leaving them set to 0xFFFF
+// rewriting it to just run the upgrade app. Next it writes each page of the bootloader
+// in sequence, padding the last one with 0xFFFF. The pages that already hold the new
+// contents are skipped, and each page written is read back to verify it.
 // Finally upgrader erases it's interrupt table again and fills it with RJMPs to
 // bootloaderAddress, effectively bridging the interrupts in to the new bootloader's
 // interrupts table.
@@ -40,13 +41,17 @@
 #include <avr/boot.h>
 #include "./bootloader_data.c"
 
-void secure_interrupt_vector_table(void);
-void write_new_bootloader(void);
-void forward_interrupt_vector_table(void);
+#define PAGE_TRIES 3 // times a page is written before giving up when it doesn't verify
+
+boolean secure_interrupt_vector_table(void);
+boolean write_new_bootloader(void);
+boolean forward_interrupt_vector_table(void);
 void beep(void);
+void fail(void);
 void reboot(void);
 
-void load_table(uint16_t address, uint16_t words[SPM_PAGESIZE / 2]);
+boolean program_page(uint16_t address, uint16_t words[SPM_PAGESIZE / 2]);
+boolean page_matches(uint16_t address, uint16_t words[SPM_PAGESIZE / 2]);
 void erase_page(uint16_t address);
 void write_page(uint16_t address, uint16_t words[SPM_PAGESIZE / 2]);
 
@@ -59,9 +64,15 @@ int main(void) {
   delay(250);
   cli();
   
-  secure_interrupt_vector_table(); // reset our vector table to it's original state
-  write_new_bootloader();
-  forward_interrupt_vector_table();
+  if (!secure_interrupt_vector_table()) { // reset our vector table to it's original state
+    fail();
+  }
+  if (!write_new_bootloader()) {
+    fail(); // the vector table is still a nop sled, a reset restarts the update
+  }
+  if (!forward_interrupt_vector_table()) {
+    fail();
+  }
   
   beep();
   
@@ -71,25 +82,23 @@ int main(void) {
 }
 
 // erase first page, removing any interrupt table hooks the bootloader added when
-// upgrade was uploaded
-void secure_interrupt_vector_table(void) {
+// upgrade was uploaded. The blank page is a nop sled in to the upgrader, so from
+// now on a reset restarts the update instead of entering a half written bootloader
+boolean secure_interrupt_vector_table(void) {
   uint16_t table[SPM_PAGESIZE / 2];
   
-  load_table(0, table);
-  
-  // wipe out any interrupt hooks the bootloader rewrote
+  // wipe out the whole table, including any interrupt hooks the bootloader rewrote
   int i = 0;
   while (i < SPM_PAGESIZE / 2) {
-    table[0] = 0xFFFF;
+    table[i] = 0xFFFF;
     i++;
   }
   
-  erase_page(0);
-  write_page(0, table);
+  return program_page(0, table);
 }
 
-// erase bootloader's section and write over it with new bootloader code
-void write_new_bootloader(void) {
+// write over bootloader's section with new bootloader code, only the pages that changed
+boolean write_new_bootloader(void) {
   uint16_t outgoing_page[SPM_PAGESIZE / 2];
   int iter = 0;
   while (iter < sizeof(bootloader_data)) {
@@ -107,17 +116,18 @@ void write_new_bootloader(void) {
       word_addr += 2;
     }
     
-    // erase page in destination
-    erase_page(bootloader_address + iter);
-    // write updated page
-    write_page(bootloader_address + iter, outgoing_page);
+    // erase and write the destination page, unless it's already up to date
+    if (!program_page(bootloader_address + iter, outgoing_page)) {
+      return false;
+    }
     
-    iter += 64;
+    iter += SPM_PAGESIZE;
   }
+  return true;
 }
 
 // write in forwarding interrupt vector table
-void forward_interrupt_vector_table(void) {
+boolean forward_interrupt_vector_table(void) {
   uint16_t vector_table[SPM_PAGESIZE / 2];
   
   int iter = 0;
@@ -127,18 +137,34 @@ void forward_interrupt_vector_table(void) {
     iter++;
   }
   
-  erase_page(0);
-  write_page(0, vector_table);
+  return program_page(0, vector_table);
+}
+
+// erase and write a page only when its contents differ, then read it back to verify it
+boolean program_page(uint16_t address, uint16_t words[SPM_PAGESIZE / 2]) {
+  byte tries = 0;
+  while (!page_matches(address, words)) {
+    if (tries == PAGE_TRIES) {
+      return false;
+    }
+    erase_page(address);
+    write_page(address, words);
+    tries++;
+  }
+  return true;
 }
 
-void load_table(uint16_t address, uint16_t words[SPM_PAGESIZE / 2]) {
+boolean page_matches(uint16_t address, uint16_t words[SPM_PAGESIZE / 2]) {
   uint16_t subaddress = 0;
   address -= address % SPM_PAGESIZE; // round down to nearest page start
   
   while (subaddress < SPM_PAGESIZE) {
-    words[subaddress / 2] = pgm_read_word(address + subaddress);
+    if (pgm_read_word(address + subaddress) != words[subaddress / 2]) {
+      return false;
+    }
     subaddress += 2;
   }
+  return true;
 }
 
 void erase_page(uint16_t address) {
@@ -173,6 +199,15 @@ void beep(void) {
   }
 }
 
+// a page doesn't verify: keep beeping until powered down, without rebooting
+// in to a damaged bootloader
+void fail(void) {
+  while (1) {
+    beep();
+    delay(250);
+  }
+}
+
 void reboot(void) {
   void (*ptrToFunction)(); // pointer to a function 
   ptrToFunction = 0x0000;